@@ -0,0 +1,100 @@
+/* Copyright 2015 Rasmus Dall - rasmus@dall.dk
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+
+#include "jndslam_api.h"
+
+// Utterances are reused by each thread so stylising allocates nothing once they have grown
+static thread_local typename utterance::utterance api_utt("");
+static thread_local std::vector<contour_stats> api_contours;
+
+stylise_options::stylise_options()
+{
+  this->algorithm = SIMPLIFIED;
+  this->smoothing = true;
+}
+
+// The style of a stylised syllable
+void syllable_style(const typename syllable::syllable &syll, segment_style &out)
+{
+  out.start = syll.contour_start;
+  out.direction = syll.contour_direction;
+  out.extreme = syll.contour_extreme;
+  out.extreme_pos = syll.contour_extreme_pos;
+  out.raw_start = syll.raw_start;
+  out.raw_direction = syll.raw_direction;
+  out.raw_extreme = syll.raw_extreme;
+  out.raw_extreme_pos = syll.raw_extreme_pos;
+}
+
+// The mean pitch of the voiced frames of a track
+float track_mean_pitch(const float *voicing, const float *f0, size_t num_frames)
+{
+  pitch_sum sum = {0, 0, 0};
+  for (size_t i = 0; i < num_frames; i++)
+  {
+    if (voicing[i] == 1)
+    {
+      add_pitch_value(sum, f0[i]);
+    }
+  }
+  return calc_mean_pitch(sum);
+}
+
+// Find the frames of segments given in seconds
+void segment_frames(const float *starts, const float *ends, size_t num_segments, size_t num_frames, size_t *begins, size_t *frame_ends)
+{
+  for (size_t i = 0; i < num_segments; i++)
+  {
+    segment_frame_range(starts[i], ends[i], num_frames, begins[i], frame_ends[i]);
+  }
+}
+
+// Stylise segments of a pitch track held by the caller
+void stylise_segments(const float *times, const float *voicing, const float *f0, size_t num_frames,
+                      const size_t *begins, const size_t *ends, size_t num_segments,
+                      float mean_pitch, const stylise_options &options, segment_style *out)
+{
+  typename utterance::utterance &utt = api_utt;
+  utt.sylls.resize(num_segments, typename syllable::syllable(0, 0, ""));
+  for (size_t i = 0; i < num_segments; i++)
+  {
+    if (begins[i] > ends[i] || ends[i] > num_frames)
+    {
+      throw std::invalid_argument("Segment "+std::to_string(i)+" has frames "+std::to_string(begins[i])+" to "+std::to_string(ends[i])+" which are not within the "+std::to_string(num_frames)+" frames of the track");
+    }
+    utt.sylls[i].frames_begin = begins[i];
+    utt.sylls[i].frames_end = ends[i];
+  }
+  
+  // Smoothing and removing unvoiced frames only read the track so it is used where it is
+  pitch_span frames(const_cast<float *>(times), const_cast<float *>(voicing), const_cast<float *>(f0), num_frames);
+  if (options.smoothing)
+  {
+    smooth_params params = options.smoothing_params;
+    smooth_stats stats;
+    smooth_utt(utt, frames, params, stats);
+  }
+  else
+  {
+    remove_unvoiced_utt(utt, frames);
+  }
+  find_contours(utt, mean_pitch, api_contours);
+  style_contours(utt, api_contours, options.algorithm);
+  
+  for (size_t i = 0; i < num_segments; i++)
+  {
+    syllable_style(utt.sylls[i], out[i]);
+  }
+}
@@ -0,0 +1,77 @@
+/* Copyright 2015 Rasmus Dall - rasmus@dall.dk
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+
+#ifndef JNDSLAM_API_H
+#define JNDSLAM_API_H
+
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <cstddef>
+
+#include "utterance.h"
+#include "syllable.h"
+#include "pitch_track.h"
+#include "jndslam_std.h"
+#include "jndslam_io.h"
+#include "jndslam_style.h"
+#include "jndslam_smooth.h"
+#include "jndslam_c.h"
+
+// The C++ interface of libjndslam. It stylises pitch tracks held by the caller without files and
+// without copying the track. The C interface in jndslam_c.h wraps it.
+
+// How to stylise
+struct stylise_options
+{
+public:
+  stylise_options();
+  Style_Alg algorithm;
+  bool smoothing;
+  smooth_params smoothing_params;
+};
+
+// The stylisation of a segment. It has the layout of jndslam_style so the C interface can use it in place.
+struct segment_style
+{
+  Contour_Label start;
+  Contour_Label direction;
+  Contour_Label extreme;
+  Extreme_Position extreme_pos;
+  float raw_start;
+  float raw_direction;
+  float raw_extreme;
+  float raw_extreme_pos;
+};
+
+// The style of a stylised syllable
+void syllable_style(const typename syllable::syllable &syll, segment_style &out);
+
+// The mean pitch of the voiced frames of a track, for when a speaker's mean is not known
+float track_mean_pitch(const float *voicing, const float *f0, size_t num_frames);
+
+// Find the frames [begins[i], ends[i]) of segments from starts[i] to ends[i] seconds in a track of
+// num_frames 5ms frames, as parse_est does for the segments of a lab file
+void segment_frames(const float *starts, const float *ends, size_t num_segments, size_t num_frames, size_t *begins, size_t *frame_ends);
+
+// Stylise segments of a pitch track relative to mean_pitch and write the style of segment i to out[i].
+// Frame i has times[i], voicing[i] (1 if voiced) and f0[i]. Segment i covers frames [begins[i], ends[i]).
+// The track is only read. Gives the same labels as the jndslam program for the same frames and segments.
+// Calls from different threads are independent. Throws if a segment is not within the track.
+void stylise_segments(const float *times, const float *voicing, const float *f0, size_t num_frames,
+                      const size_t *begins, const size_t *ends, size_t num_segments,
+                      float mean_pitch, const stylise_options &options, segment_style *out);
+
+#endif
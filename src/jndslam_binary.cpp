@@ -0,0 +1,324 @@
+/* Copyright 2015 Rasmus Dall - rasmus@dall.dk
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+#include "jndslam_binary.h"
+
+static const char STYB_MAGIC[8] = {'J', 'N', 'D', 'S', 'T', 'Y', 'B', '\0'};
+static const uint32_t STYB_BYTE_ORDER = 0x01020304;
+
+// Round up to the next 8 byte boundary
+static uint64_t align8(uint64_t offset)
+{
+  return (offset + 7) & ~(uint64_t)7;
+}
+
+styb_builder::styb_builder(Style_Alg algorithm, size_t num_utts)
+{
+  this->algorithm = algorithm;
+  this->utts.resize(num_utts);
+}
+
+// Store the stylisation of utterance i
+void styb_builder::add_utt(size_t i, typename utterance::utterance &utt)
+{
+  utt_columns &out = utts[i];
+  out.name = utt.name;
+  size_t n = utt.sylls.size();
+  out.start.resize(n);
+  out.end.resize(n);
+  out.identities.clear();
+  out.identity_sizes.resize(n);
+  for (size_t l = 0; l < 4; l++)
+  {
+    out.labels[l].resize(n);
+    out.raw[l].resize(algorithm == RAW ? n : 0);
+  }
+  for (size_t j = 0; j < n; j++)
+  {
+    typename syllable::syllable &syll = utt.sylls[j];
+    out.start[j] = syll.start;
+    out.end[j] = syll.end;
+    out.identities += syll.identity;
+    out.identity_sizes[j] = syll.identity.size();
+    out.labels[0][j] = syll.contour_start;
+    out.labels[1][j] = syll.contour_direction;
+    out.labels[2][j] = syll.contour_extreme;
+    out.labels[3][j] = syll.contour_extreme_pos;
+    if (algorithm == RAW)
+    {
+      out.raw[0][j] = syll.raw_start;
+      out.raw[1][j] = syll.raw_direction;
+      out.raw[2][j] = syll.raw_extreme;
+      out.raw[3][j] = syll.raw_extreme_pos;
+    }
+  }
+}
+
+// Lay out the columns and queue the file on writer
+void styb_builder::write(const std::string &path, file_writer &writer)
+{
+  styb_header header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, STYB_MAGIC, sizeof(STYB_MAGIC));
+  header.version = STYB_VERSION;
+  header.byte_order = STYB_BYTE_ORDER;
+  header.algorithm = algorithm;
+  header.has_raw = algorithm == RAW;
+  header.num_utts = utts.size();
+  uint64_t names_size = 0;
+  uint64_t identities_size = 0;
+  for (size_t i = 0; i < utts.size(); i++)
+  {
+    header.num_sylls += utts[i].start.size();
+    names_size += utts[i].name.size();
+    identities_size += utts[i].identities.size();
+  }
+  
+  // Size and place every column
+  uint64_t u = header.num_utts;
+  uint64_t n = header.num_sylls;
+  uint64_t raw_size = header.has_raw ? n * sizeof(float) : 0;
+  uint64_t sizes[STYB_COLUMNS] = {
+    (u + 1) * sizeof(uint64_t), (u + 1) * sizeof(uint64_t), names_size,
+    n * sizeof(float), n * sizeof(float),
+    (n + 1) * sizeof(uint64_t), identities_size,
+    n, n, n, n,
+    raw_size, raw_size, raw_size, raw_size
+  };
+  uint64_t offset = align8(sizeof(header));
+  for (size_t c = 0; c < STYB_COLUMNS; c++)
+  {
+    header.column_offset[c] = offset;
+    header.column_size[c] = sizes[c];
+    offset = align8(offset + sizes[c]);
+  }
+  
+  std::string buffer = writer.take_buffer();
+  buffer.assign(offset, '\0');
+  char *data = &buffer[0];
+  memcpy(data, &header, sizeof(header));
+  uint64_t *utt_sylls = (uint64_t *)(data + header.column_offset[STYB_UTT_SYLLS]);
+  uint64_t *utt_names = (uint64_t *)(data + header.column_offset[STYB_UTT_NAMES]);
+  char *names = data + header.column_offset[STYB_NAMES];
+  float *start = (float *)(data + header.column_offset[STYB_START]);
+  float *end = (float *)(data + header.column_offset[STYB_END]);
+  uint64_t *identity_offsets = (uint64_t *)(data + header.column_offset[STYB_IDENTITY_OFFSETS]);
+  char *identities = data + header.column_offset[STYB_IDENTITIES];
+  
+  uint64_t row = 0;
+  uint64_t name_offset = 0;
+  uint64_t identity_offset = 0;
+  for (size_t i = 0; i < utts.size(); i++)
+  {
+    utt_columns &utt = utts[i];
+    size_t count = utt.start.size();
+    utt_sylls[i] = row;
+    utt_names[i] = name_offset;
+    memcpy(names + name_offset, utt.name.data(), utt.name.size());
+    name_offset += utt.name.size();
+    if (count > 0)
+    {
+      memcpy(start + row, utt.start.data(), count * sizeof(float));
+      memcpy(end + row, utt.end.data(), count * sizeof(float));
+      for (size_t l = 0; l < 4; l++)
+      {
+        memcpy(data + header.column_offset[STYB_CONTOUR_START + l] + row, utt.labels[l].data(), count);
+        if (header.has_raw)
+        {
+          memcpy(data + header.column_offset[STYB_RAW_START + l] + row * sizeof(float), utt.raw[l].data(), count * sizeof(float));
+        }
+      }
+    }
+    memcpy(identities + identity_offset, utt.identities.data(), utt.identities.size());
+    for (size_t j = 0; j < count; j++)
+    {
+      identity_offsets[row + j] = identity_offset;
+      identity_offset += utt.identity_sizes[j];
+    }
+    row += count;
+  }
+  utt_sylls[u] = row;
+  utt_names[u] = name_offset;
+  identity_offsets[n] = identity_offset;
+  
+  writer.submit(path, buffer);
+}
+
+styb_reader::styb_reader(const std::string &path) : file(path, false)
+{
+  text_view text = file.text();
+  if (text.size < sizeof(styb_header) || memcmp(text.data, STYB_MAGIC, sizeof(STYB_MAGIC)) != 0)
+  {
+    throw std::invalid_argument("Not a binary stylisation file: "+path);
+  }
+  header = (const styb_header *)text.data;
+  if (header->byte_order != STYB_BYTE_ORDER)
+  {
+    throw std::invalid_argument("Binary stylisation file was written on a machine with a different byte order: "+path);
+  }
+  if (header->version != STYB_VERSION)
+  {
+    throw std::invalid_argument("Unsupported binary stylisation file version "+std::to_string(header->version)+": "+path);
+  }
+  // Every column must have the size its counts call for and lie within the file
+  uint64_t u = header->num_utts;
+  uint64_t n = header->num_sylls;
+  uint64_t raw_size = header->has_raw ? n * sizeof(float) : 0;
+  uint64_t sizes[STYB_COLUMNS] = {
+    (u + 1) * sizeof(uint64_t), (u + 1) * sizeof(uint64_t), header->column_size[STYB_NAMES],
+    n * sizeof(float), n * sizeof(float),
+    (n + 1) * sizeof(uint64_t), header->column_size[STYB_IDENTITIES],
+    n, n, n, n,
+    raw_size, raw_size, raw_size, raw_size
+  };
+  for (size_t c = 0; c < STYB_COLUMNS; c++)
+  {
+    if (header->column_size[c] != sizes[c] || header->column_offset[c] % 8 != 0 || header->column_offset[c] > text.size || header->column_size[c] > text.size - header->column_offset[c])
+    {
+      throw std::invalid_argument("Binary stylisation file is truncated or corrupt: "+path);
+    }
+  }
+  for (size_t i = 0; i < num_utts(); i++)
+  {
+    utt_index[utt_name(i).str()] = i;
+  }
+}
+
+// Pointer to the start of a column
+const char *styb_reader::column(Styb_Column col) const
+{
+  return file.text().data + header->column_offset[col];
+}
+
+Style_Alg styb_reader::algorithm() const
+{
+  return (Style_Alg)header->algorithm;
+}
+
+bool styb_reader::has_raw() const
+{
+  return header->has_raw != 0;
+}
+
+size_t styb_reader::num_utts() const
+{
+  return header->num_utts;
+}
+
+size_t styb_reader::num_sylls() const
+{
+  return header->num_sylls;
+}
+
+// The index of an utterance by name
+size_t styb_reader::find_utt(const std::string &name) const
+{
+  std::unordered_map<std::string, size_t>::const_iterator it = utt_index.find(name);
+  return it == utt_index.end() ? num_utts() : it->second;
+}
+
+text_view styb_reader::utt_name(size_t utt) const
+{
+  const uint64_t *offsets = (const uint64_t *)column(STYB_UTT_NAMES);
+  return text_view(column(STYB_NAMES) + offsets[utt], offsets[utt + 1] - offsets[utt]);
+}
+
+size_t styb_reader::utt_begin(size_t utt) const
+{
+  return ((const uint64_t *)column(STYB_UTT_SYLLS))[utt];
+}
+
+size_t styb_reader::utt_end(size_t utt) const
+{
+  return ((const uint64_t *)column(STYB_UTT_SYLLS))[utt + 1];
+}
+
+const float *styb_reader::start() const
+{
+  return (const float *)column(STYB_START);
+}
+
+const float *styb_reader::end() const
+{
+  return (const float *)column(STYB_END);
+}
+
+text_view styb_reader::identity(size_t syll) const
+{
+  const uint64_t *offsets = (const uint64_t *)column(STYB_IDENTITY_OFFSETS);
+  return text_view(column(STYB_IDENTITIES) + offsets[syll], offsets[syll + 1] - offsets[syll]);
+}
+
+const Contour_Label *styb_reader::contour_start() const
+{
+  return (const Contour_Label *)column(STYB_CONTOUR_START);
+}
+
+const Contour_Label *styb_reader::contour_direction() const
+{
+  return (const Contour_Label *)column(STYB_CONTOUR_DIRECTION);
+}
+
+const Contour_Label *styb_reader::contour_extreme() const
+{
+  return (const Contour_Label *)column(STYB_CONTOUR_EXTREME);
+}
+
+const Extreme_Position *styb_reader::contour_extreme_pos() const
+{
+  return (const Extreme_Position *)column(STYB_CONTOUR_EXTREME_POS);
+}
+
+const float *styb_reader::raw_start() const
+{
+  return has_raw() ? (const float *)column(STYB_RAW_START) : NULL;
+}
+
+const float *styb_reader::raw_direction() const
+{
+  return has_raw() ? (const float *)column(STYB_RAW_DIRECTION) : NULL;
+}
+
+const float *styb_reader::raw_extreme() const
+{
+  return has_raw() ? (const float *)column(STYB_RAW_EXTREME) : NULL;
+}
+
+const float *styb_reader::raw_extreme_pos() const
+{
+  return has_raw() ? (const float *)column(STYB_RAW_EXTREME_POS) : NULL;
+}
+
+// Copy an utterance into utt
+void styb_reader::read_utt(size_t i, typename utterance::utterance &utt) const
+{
+  utt.name = utt_name(i).str();
+  utt.sylls.clear();
+  for (size_t j = utt_begin(i); j < utt_end(i); j++)
+  {
+    utt.sylls.push_back(typename syllable::syllable(start()[j], end()[j], identity(j).str()));
+    typename syllable::syllable &syll = utt.sylls.back();
+    syll.contour_start = contour_start()[j];
+    syll.contour_direction = contour_direction()[j];
+    syll.contour_extreme = contour_extreme()[j];
+    syll.contour_extreme_pos = contour_extreme_pos()[j];
+    if (has_raw())
+    {
+      syll.raw_start = raw_start()[j];
+      syll.raw_direction = raw_direction()[j];
+      syll.raw_extreme = raw_extreme()[j];
+      syll.raw_extreme_pos = raw_extreme_pos()[j];
+    }
+  }
+}
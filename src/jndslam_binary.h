@@ -0,0 +1,149 @@
+/* Copyright 2015 Rasmus Dall - rasmus@dall.dk
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+#ifndef JNDSLAM_BINARY_H
+#define JNDSLAM_BINARY_H
+
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <unordered_map>
+#include <cstring>
+#include <stdint.h>
+
+#include "utterance.h"
+#include "syllable.h"
+#include "jndslam_std.h"
+#include "jndslam_io.h"
+#include "jndslam_style.h"
+#include "jndslam_writer.h"
+
+// Binary stylisation files (.styb) hold the stylisation of a whole corpus as typed columns with
+// one row per syllable, so they can be memory mapped and used without any parsing.
+//
+// The file starts with a styb_header followed by the columns, each starting on an 8 byte boundary:
+//   STYB_UTT_SYLLS         uint64 x (utts + 1)   the rows of utt i are [utt_sylls[i], utt_sylls[i + 1])
+//   STYB_UTT_NAMES         uint64 x (utts + 1)   the name of utt i is names[utt_names[i], utt_names[i + 1])
+//   STYB_NAMES             char                  utt names, not null terminated
+//   STYB_START, STYB_END   float x sylls         syllable times in seconds
+//   STYB_IDENTITY_OFFSETS  uint64 x (sylls + 1)  as STYB_UTT_NAMES for syllable identities
+//   STYB_IDENTITIES        char
+//   STYB_CONTOUR_*         uint8 x sylls         Contour_Label and Extreme_Position codes
+//   STYB_RAW_*             float x sylls         the raw values, only present for the RAW algorithm
+// Numbers are in the byte order of the machine that wrote the file.
+
+// Columns of a binary stylisation file in the order they are stored
+enum Styb_Column
+{
+  STYB_UTT_SYLLS,
+  STYB_UTT_NAMES,
+  STYB_NAMES,
+  STYB_START,
+  STYB_END,
+  STYB_IDENTITY_OFFSETS,
+  STYB_IDENTITIES,
+  STYB_CONTOUR_START,
+  STYB_CONTOUR_DIRECTION,
+  STYB_CONTOUR_EXTREME,
+  STYB_CONTOUR_EXTREME_POS,
+  STYB_RAW_START,
+  STYB_RAW_DIRECTION,
+  STYB_RAW_EXTREME,
+  STYB_RAW_EXTREME_POS,
+  STYB_COLUMNS
+};
+
+const uint32_t STYB_VERSION = 1;
+
+// The header at the start of a binary stylisation file
+struct styb_header
+{
+  char magic[8];                          // "JNDSTYB" and a null
+  uint32_t version;                       // STYB_VERSION
+  uint32_t byte_order;                    // 0x01020304 as written by the writing machine
+  uint32_t algorithm;                     // Style_Alg
+  uint32_t has_raw;                       // Are the raw columns present?
+  uint64_t num_utts;
+  uint64_t num_sylls;
+  uint64_t column_offset[STYB_COLUMNS];   // Byte offset of each column from the start of the file
+  uint64_t column_size[STYB_COLUMNS];     // Size of each column in bytes
+};
+
+// Collects the stylisations of a corpus and writes them as a binary stylisation file.
+// Utterances keep the order of their index however they are added.
+class styb_builder
+{
+public:
+  styb_builder(Style_Alg algorithm, size_t num_utts);
+  // Store the stylisation of utterance i. Different utterances can be added from different threads.
+  void add_utt(size_t i, typename utterance::utterance &utt);
+  // Lay out the columns and queue the file on writer
+  void write(const std::string &path, file_writer &writer);
+private:
+  // The columns of one utterance
+  struct utt_columns
+  {
+    std::string name;
+    std::vector<float> start;
+    std::vector<float> end;
+    std::string identities;
+    std::vector<uint64_t> identity_sizes;
+    std::vector<unsigned char> labels[4];
+    std::vector<float> raw[4];
+  };
+  Style_Alg algorithm;
+  std::vector<utt_columns> utts;
+};
+
+// Read access to a binary stylisation file. The file is memory mapped and every
+// column is used in place, nothing is copied. Throws if the file is not a valid
+// binary stylisation file or was written on a machine with a different byte order.
+class styb_reader
+{
+public:
+  explicit styb_reader(const std::string &path);
+  Style_Alg algorithm() const;
+  bool has_raw() const;
+  size_t num_utts() const;
+  size_t num_sylls() const;
+  // The index of an utterance by name or num_utts() if there is none
+  size_t find_utt(const std::string &name) const;
+  text_view utt_name(size_t utt) const;
+  // The syllable rows of an utterance are [utt_begin, utt_end)
+  size_t utt_begin(size_t utt) const;
+  size_t utt_end(size_t utt) const;
+  // The columns, indexed by syllable row
+  const float *start() const;
+  const float *end() const;
+  text_view identity(size_t syll) const;
+  const Contour_Label *contour_start() const;
+  const Contour_Label *contour_direction() const;
+  const Contour_Label *contour_extreme() const;
+  const Extreme_Position *contour_extreme_pos() const;
+  // The raw columns are NULL unless has_raw()
+  const float *raw_start() const;
+  const float *raw_direction() const;
+  const float *raw_extreme() const;
+  const float *raw_extreme_pos() const;
+  // Copy an utterance into utt, e.g. to write it out as text with format_utt
+  void read_utt(size_t i, typename utterance::utterance &utt) const;
+private:
+  // Pointer to the start of a column
+  const char *column(Styb_Column col) const;
+  mapped_file file;
+  const styb_header *header;
+  std::unordered_map<std::string, size_t> utt_index;
+};
+
+#endif
@@ -0,0 +1,196 @@
+/* Copyright 2015 Rasmus Dall - rasmus@dall.dk
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+
+#include "jndslam_online.h"
+
+// The C structs must match the C++ ones they are passed as
+static_assert(sizeof(jndslam_style) == sizeof(segment_style), "jndslam_style and segment_style differ");
+static_assert(offsetof(jndslam_style, raw_start) == offsetof(segment_style, raw_start), "jndslam_style and segment_style differ");
+static_assert(offsetof(jndslam_style, raw_extreme_pos) == offsetof(segment_style, raw_extreme_pos), "jndslam_style and segment_style differ");
+static_assert((int)JNDSLAM_ALG_RAW == (int)RAW && (int)JNDSLAM_ALG_SIMPLIFIED == (int)SIMPLIFIED, "jndslam_algorithm and Style_Alg differ");
+
+// The message of the last failure on each thread
+static thread_local std::string last_error;
+
+// The C++ styliser behind a C handle
+struct jndslam_online
+{
+  jndslam_online(float mean_pitch, const stylise_options &options, size_t context_frames, size_t lookahead_frames)
+    : styliser(mean_pitch, options, context_frames, lookahead_frames)
+  {
+  }
+  online_styliser styliser;
+};
+
+// Convert C options. Throws on an unknown algorithm.
+static stylise_options convert_options(const jndslam_options *options)
+{
+  if (options->algorithm < JNDSLAM_ALG_SIMPLIFIED || options->algorithm > JNDSLAM_ALG_RAW)
+  {
+    throw std::invalid_argument("Unknown algorithm "+std::to_string(options->algorithm));
+  }
+  stylise_options settings;
+  settings.algorithm = (Style_Alg)options->algorithm;
+  settings.smoothing = options->smoothing != 0;
+  settings.smoothing_params.span = options->span;
+  settings.smoothing_params.iters = options->iters;
+  settings.smoothing_params.tolerance = options->tolerance;
+  settings.smoothing_params.delta = options->delta;
+  settings.smoothing_params.single_precision = options->single_precision != 0;
+  settings.smoothing_params.scope = options->whole_utterance ? SCOPE_UTTERANCE : SCOPE_SEGMENT;
+  return settings;
+}
+
+// Set options to the defaults of the jndslam program
+void jndslam_default_options(jndslam_options *options)
+{
+  stylise_options defaults;
+  options->algorithm = defaults.algorithm;
+  options->smoothing = defaults.smoothing;
+  options->span = defaults.smoothing_params.span;
+  options->iters = defaults.smoothing_params.iters;
+  options->tolerance = defaults.smoothing_params.tolerance;
+  options->delta = defaults.smoothing_params.delta;
+  options->single_precision = defaults.smoothing_params.single_precision;
+  options->whole_utterance = defaults.smoothing_params.scope == SCOPE_UTTERANCE;
+}
+
+// The mean pitch of the voiced frames of a track
+float jndslam_mean_pitch(const float *voicing, const float *f0, size_t num_frames)
+{
+  return track_mean_pitch(voicing, f0, num_frames);
+}
+
+// Find the frames of segments given in seconds
+void jndslam_segment_frames(const float *starts, const float *ends, size_t num_segments, size_t num_frames, size_t *begins, size_t *ends_out)
+{
+  segment_frames(starts, ends, num_segments, num_frames, begins, ends_out);
+}
+
+// Stylise segments of a pitch track
+int jndslam_stylise(const float *times, const float *voicing, const float *f0, size_t num_frames,
+                    const size_t *begins, const size_t *ends, size_t num_segments,
+                    float mean_pitch, const jndslam_options *options, jndslam_style *out)
+{
+  // No exception may cross into C
+  try
+  {
+    stylise_options settings = convert_options(options);
+    stylise_segments(times, voicing, f0, num_frames, begins, ends, num_segments, mean_pitch, settings, (segment_style *)out);
+  }
+  catch (const std::exception &e)
+  {
+    last_error = e.what();
+    return -1;
+  }
+  return 0;
+}
+
+// Start stylising a track as it is generated
+jndslam_online *jndslam_online_new(float mean_pitch, const jndslam_options *options, size_t context_frames, size_t lookahead_frames)
+{
+  try
+  {
+    return new jndslam_online(mean_pitch, convert_options(options), context_frames, lookahead_frames);
+  }
+  catch (const std::exception &e)
+  {
+    last_error = e.what();
+    return NULL;
+  }
+}
+
+// Add frames to the end of the track
+int jndslam_online_push(jndslam_online *online, const float *times, const float *voicing, const float *f0, size_t num_frames)
+{
+  try
+  {
+    online->styliser.push_frames(times, voicing, f0, num_frames);
+  }
+  catch (const std::exception &e)
+  {
+    last_error = e.what();
+    return -1;
+  }
+  return 0;
+}
+
+// End the current segment
+int jndslam_online_end_segment(jndslam_online *online, size_t end_frame)
+{
+  try
+  {
+    online->styliser.end_segment(end_frame);
+  }
+  catch (const std::exception &e)
+  {
+    last_error = e.what();
+    return -1;
+  }
+  return 0;
+}
+
+// There are no more frames
+int jndslam_online_finish(jndslam_online *online)
+{
+  online->styliser.finish();
+  return 0;
+}
+
+// Write the style of the next ready segment
+int jndslam_online_next(jndslam_online *online, jndslam_style *out)
+{
+  try
+  {
+    return online->styliser.next_style(*(segment_style *)out) ? 1 : 0;
+  }
+  catch (const std::exception &e)
+  {
+    last_error = e.what();
+    return -1;
+  }
+}
+
+// Free a styliser
+void jndslam_online_free(jndslam_online *online)
+{
+  delete online;
+}
+
+// The text of a label code
+const char *jndslam_label_text(unsigned char label)
+{
+  if (label > LABEL_NEGATIVE)
+  {
+    return "";
+  }
+  return contour_label_text((Contour_Label)label);
+}
+
+// The text of an extreme position code
+const char *jndslam_position_text(unsigned char position)
+{
+  if (position > POS_END)
+  {
+    return "";
+  }
+  return extreme_position_text((Extreme_Position)position);
+}
+
+// The message of the last failure on this thread
+const char *jndslam_last_error(void)
+{
+  return last_error.c_str();
+}
@@ -0,0 +1,112 @@
+/* Copyright 2015 Rasmus Dall - rasmus@dall.dk
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+
+#ifndef JNDSLAM_C_H
+#define JNDSLAM_C_H
+
+#include <stddef.h>
+
+/* The C interface of libjndslam. It stylises a pitch track held by the caller, see
+   stylise_segments in jndslam_api.h which these functions wrap. Functions that can fail
+   return 0 on success and -1 on failure with a message from jndslam_last_error(). */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* The algorithms, with the values of Style_Alg */
+enum jndslam_algorithm {JNDSLAM_ALG_SIMPLIFIED, JNDSLAM_ALG_JNDSLAM, JNDSLAM_ALG_SLAM, JNDSLAM_ALG_RAW};
+
+/* The stylisation of a segment. Labels are Contour_Label codes and extreme_pos an
+   Extreme_Position code, see syllable.h and jndslam_label_text(). The raw values are
+   only set for labels of JNDSLAM_LABEL_RAW. */
+typedef struct jndslam_style
+{
+  unsigned char start;
+  unsigned char direction;
+  unsigned char extreme;
+  unsigned char extreme_pos;
+  float raw_start;
+  float raw_direction;
+  float raw_extreme;
+  float raw_extreme_pos;
+} jndslam_style;
+
+/* How to stylise */
+typedef struct jndslam_options
+{
+  int algorithm;            /* A jndslam_algorithm */
+  int smoothing;            /* Smooth the pitch before stylising? */
+  float span;               /* Fraction of a segment's voiced frames used for each local fit */
+  unsigned int iters;       /* Largest number of robustness iterations */
+  double tolerance;         /* Stop iterating once no robustness weight changes by more than this */
+  double delta;             /* Interpolate between fits closer than this in seconds, 0 fits every frame */
+  int single_precision;     /* Fit in single precision */
+  int whole_utterance;      /* Smooth the whole track at once instead of each segment on its own */
+} jndslam_options;
+
+/* Set options to the defaults of the jndslam program */
+void jndslam_default_options(jndslam_options *options);
+
+/* The mean pitch of the voiced frames of a track */
+float jndslam_mean_pitch(const float *voicing, const float *f0, size_t num_frames);
+
+/* Find the frames [begins[i], ends[i]) of segments starting and ending at the given times in seconds
+   in a track of 5ms frames, as for the segments of a lab file. Segments past the end of the track are cut short. */
+void jndslam_segment_frames(const float *starts, const float *ends, size_t num_segments, size_t num_frames, size_t *begins, size_t *ends_out);
+
+/* Stylise segments of a pitch track relative to mean_pitch. Frame i has times[i], voicing[i] (1 if voiced)
+   and f0[i]. Segment i covers frames [begins[i], ends[i]). out must hold num_segments styles. */
+int jndslam_stylise(const float *times, const float *voicing, const float *f0, size_t num_frames,
+                    const size_t *begins, const size_t *ends, size_t num_segments,
+                    float mean_pitch, const jndslam_options *options, jndslam_style *out);
+
+/* Stylises a pitch track while it is being generated, see online_styliser in jndslam_online.h */
+typedef struct jndslam_online jndslam_online;
+
+/* Start stylising a track relative to mean_pitch. Each segment is smoothed with up to context_frames
+   frames before it and lookahead_frames after it, whole_utterance in options is not used.
+   Returns NULL on failure. */
+jndslam_online *jndslam_online_new(float mean_pitch, const jndslam_options *options, size_t context_frames, size_t lookahead_frames);
+
+/* Add frames to the end of the track */
+int jndslam_online_push(jndslam_online *online, const float *times, const float *voicing, const float *f0, size_t num_frames);
+
+/* End the current segment before frame end_frame of the track. The next segment begins there. */
+int jndslam_online_end_segment(jndslam_online *online, size_t end_frame);
+
+/* There are no more frames */
+int jndslam_online_finish(jndslam_online *online);
+
+/* Write the style of the next segment to out if it is ready. Returns 1 if it was, 0 if not and -1 on failure. */
+int jndslam_online_next(jndslam_online *online, jndslam_style *out);
+
+/* Free a styliser */
+void jndslam_online_free(jndslam_online *online);
+
+/* The text of a label code as written in .sty files */
+const char *jndslam_label_text(unsigned char label);
+
+/* The text of an extreme position code, written before the extreme label */
+const char *jndslam_position_text(unsigned char position);
+
+/* The message of the last failure on this thread */
+const char *jndslam_last_error(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
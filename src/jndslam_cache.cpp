@@ -0,0 +1,233 @@
+/* Copyright 2015 Rasmus Dall - rasmus@dall.dk
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+
+#include "jndslam_cache.h"
+
+static const char CACHE_MAGIC[8] = {'J', 'N', 'D', 'T', 'R', 'K', '\0', '\0'};
+// Raised when the format or what is cached changes. Version 2 parses HTS labels past 214s and
+// syllables of 10 or more phones correctly.
+static const uint32_t CACHE_VERSION = 2;
+static const uint32_t CACHE_BYTE_ORDER = 0x01020304;
+
+// The header at the start of a cache file. It is followed by the key and the arrays of cache_layout.
+struct cache_header
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t byte_order;
+  uint64_t key_size;
+  uint64_t num_sylls;
+  uint64_t num_pitch;
+  uint64_t identities_size;
+};
+
+// The arrays of a cache file in the order they are stored
+enum Cache_Array
+{
+  CACHE_KEY,
+  CACHE_START,
+  CACHE_END,
+  CACHE_IDENTITY_OFFSETS,
+  CACHE_IDENTITIES,
+  CACHE_FRAMES_BEGIN,
+  CACHE_FRAMES_END,
+  CACHE_PITCH_BEGIN,
+  CACHE_PITCH_END,
+  CACHE_TIMES,
+  CACHE_VOICING,
+  CACHE_F0,
+  CACHE_ARRAYS
+};
+
+// Round up to the next 8 byte boundary
+static uint64_t align8(uint64_t offset)
+{
+  return (offset + 7) & ~(uint64_t)7;
+}
+
+// Place every array of a cache file after the header, each on an 8 byte boundary.
+// Returns the size of the whole file.
+static uint64_t cache_layout(const cache_header &header, uint64_t offsets[CACHE_ARRAYS])
+{
+  uint64_t n = header.num_sylls;
+  uint64_t m = header.num_pitch;
+  uint64_t sizes[CACHE_ARRAYS] = {
+    header.key_size,
+    n * sizeof(float), n * sizeof(float),
+    (n + 1) * sizeof(uint64_t), header.identities_size,
+    n * sizeof(uint64_t), n * sizeof(uint64_t), n * sizeof(uint64_t), n * sizeof(uint64_t),
+    m * sizeof(float), m * sizeof(float), m * sizeof(float)
+  };
+  uint64_t offset = align8(sizeof(cache_header));
+  for (size_t a = 0; a < CACHE_ARRAYS; a++)
+  {
+    offsets[a] = offset;
+    offset = align8(offset + sizes[a]);
+  }
+  return offset;
+}
+
+// The key of an utterance made from the given input files with the given settings
+std::string cache_key(const std::vector<std::string> &input_paths, const std::string &settings)
+{
+  std::string key;
+  for (size_t i = 0; i < input_paths.size(); i++)
+  {
+    struct stat s;
+    if (stat(input_paths[i].c_str(), &s) != 0)
+    {
+      return std::string();
+    }
+    key += input_paths[i]+" "+std::to_string(s.st_size)+" "+std::to_string(s.st_mtim.tv_sec)+"."+std::to_string(s.st_mtim.tv_nsec)+"\n";
+  }
+  key += settings;
+  return key;
+}
+
+// Load the syllables and pitch track of an utterance from a cache file
+bool load_cached_utt(const std::string &path, const std::string &key, typename utterance::utterance &utt)
+{
+  struct stat s;
+  if (key.empty() || stat(path.c_str(), &s) != 0)
+  {
+    return false;
+  }
+  mapped_file file(path);
+  text_view text = file.text();
+  if (text.size < sizeof(cache_header))
+  {
+    return false;
+  }
+  cache_header header;
+  memcpy(&header, text.data, sizeof(header));
+  uint64_t offsets[CACHE_ARRAYS];
+  if (memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 || header.version != CACHE_VERSION || header.byte_order != CACHE_BYTE_ORDER
+      || header.key_size != key.size() || header.num_sylls > text.size || header.num_pitch > text.size || header.identities_size > text.size
+      || cache_layout(header, offsets) != text.size || memcmp(text.data + offsets[CACHE_KEY], key.data(), key.size()) != 0)
+  {
+    return false;
+  }
+  
+  size_t n = header.num_sylls;
+  size_t m = header.num_pitch;
+  const float *start = (const float *)(text.data + offsets[CACHE_START]);
+  const float *end = (const float *)(text.data + offsets[CACHE_END]);
+  const uint64_t *identity_offsets = (const uint64_t *)(text.data + offsets[CACHE_IDENTITY_OFFSETS]);
+  const char *identities = text.data + offsets[CACHE_IDENTITIES];
+  const uint64_t *frames_begin = (const uint64_t *)(text.data + offsets[CACHE_FRAMES_BEGIN]);
+  const uint64_t *frames_end = (const uint64_t *)(text.data + offsets[CACHE_FRAMES_END]);
+  const uint64_t *pitch_begin = (const uint64_t *)(text.data + offsets[CACHE_PITCH_BEGIN]);
+  const uint64_t *pitch_end = (const uint64_t *)(text.data + offsets[CACHE_PITCH_END]);
+  // Ranges must stay within their arrays however the file was damaged
+  for (size_t j = 0; j < n; j++)
+  {
+    if (identity_offsets[j] > identity_offsets[j + 1] || pitch_begin[j] > pitch_end[j] || pitch_end[j] > m)
+    {
+      return false;
+    }
+  }
+  if (identity_offsets[0] != 0 || identity_offsets[n] != header.identities_size)
+  {
+    return false;
+  }
+  
+  utt.sylls.clear();
+  utt.sylls.reserve(n);
+  for (size_t j = 0; j < n; j++)
+  {
+    utt.sylls.push_back(typename syllable::syllable(start[j], end[j], std::string(identities + identity_offsets[j], identity_offsets[j + 1] - identity_offsets[j])));
+    utt.sylls.back().frames_begin = frames_begin[j];
+    utt.sylls.back().frames_end = frames_end[j];
+    utt.sylls.back().pitch_begin = pitch_begin[j];
+    utt.sylls.back().pitch_end = pitch_end[j];
+  }
+  // The frames themselves are not needed once smoothed
+  utt.frames.clear();
+  const float *times = (const float *)(text.data + offsets[CACHE_TIMES]);
+  const float *voicing = (const float *)(text.data + offsets[CACHE_VOICING]);
+  const float *f0 = (const float *)(text.data + offsets[CACHE_F0]);
+  utt.pitch.times.assign(times, times + m);
+  utt.pitch.voicing.assign(voicing, voicing + m);
+  utt.pitch.f0.assign(f0, f0 + m);
+  return true;
+}
+
+// Save the syllables and pitch track of an utterance to a cache file
+void save_cached_utt(const std::string &path, const std::string &key, typename utterance::utterance &utt)
+{
+  if (key.empty())
+  {
+    return void();
+  }
+  cache_header header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+  header.version = CACHE_VERSION;
+  header.byte_order = CACHE_BYTE_ORDER;
+  header.key_size = key.size();
+  header.num_sylls = utt.sylls.size();
+  header.num_pitch = utt.pitch.size();
+  for (size_t j = 0; j < utt.sylls.size(); j++)
+  {
+    header.identities_size += utt.sylls[j].identity.size();
+  }
+  uint64_t offsets[CACHE_ARRAYS];
+  std::string buffer(cache_layout(header, offsets), '\0');
+  char *data = &buffer[0];
+  memcpy(data, &header, sizeof(header));
+  memcpy(data + offsets[CACHE_KEY], key.data(), key.size());
+  
+  size_t n = utt.sylls.size();
+  size_t m = utt.pitch.size();
+  float *start = (float *)(data + offsets[CACHE_START]);
+  float *end = (float *)(data + offsets[CACHE_END]);
+  uint64_t *identity_offsets = (uint64_t *)(data + offsets[CACHE_IDENTITY_OFFSETS]);
+  char *identities = data + offsets[CACHE_IDENTITIES];
+  uint64_t *frames_begin = (uint64_t *)(data + offsets[CACHE_FRAMES_BEGIN]);
+  uint64_t *frames_end = (uint64_t *)(data + offsets[CACHE_FRAMES_END]);
+  uint64_t *pitch_begin = (uint64_t *)(data + offsets[CACHE_PITCH_BEGIN]);
+  uint64_t *pitch_end = (uint64_t *)(data + offsets[CACHE_PITCH_END]);
+  uint64_t identity_offset = 0;
+  for (size_t j = 0; j < n; j++)
+  {
+    typename syllable::syllable &syll = utt.sylls[j];
+    start[j] = syll.start;
+    end[j] = syll.end;
+    identity_offsets[j] = identity_offset;
+    memcpy(identities + identity_offset, syll.identity.data(), syll.identity.size());
+    identity_offset += syll.identity.size();
+    frames_begin[j] = syll.frames_begin;
+    frames_end[j] = syll.frames_end;
+    pitch_begin[j] = syll.pitch_begin;
+    pitch_end[j] = syll.pitch_end;
+  }
+  identity_offsets[n] = identity_offset;
+  if (m > 0)
+  {
+    memcpy(data + offsets[CACHE_TIMES], utt.pitch.times.data(), m * sizeof(float));
+    memcpy(data + offsets[CACHE_VOICING], utt.pitch.voicing.data(), m * sizeof(float));
+    memcpy(data + offsets[CACHE_F0], utt.pitch.f0.data(), m * sizeof(float));
+  }
+  
+  // Several runs may share a cache so the file only appears once complete
+  std::string tmp_path = path+".tmp"+std::to_string(getpid());
+  write_file(tmp_path, buffer);
+  if (rename(tmp_path.c_str(), path.c_str()) != 0)
+  {
+    int error = errno;
+    unlink(tmp_path.c_str());
+    throw std::runtime_error("Could not write "+path+": "+strerror(error));
+  }
+}
@@ -0,0 +1,54 @@
+/* Copyright 2015 Rasmus Dall - rasmus@dall.dk
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+#ifndef JNDSLAM_CACHE_H
+#define JNDSLAM_CACHE_H
+
+#include <string>
+#include <vector>
+#include <iostream>
+#include <stdexcept>
+#include <cstring>
+#include <stdint.h>
+
+#include <errno.h>
+#include <stdio.h>
+#include <sys/stat.h>
+
+#include "utterance.h"
+#include "jndslam_std.h"
+#include "jndslam_io.h"
+
+// A cache of parsed and smoothed utterances so stylising the same input again skips parsing and
+// smoothing. Each utterance is kept in its own file holding its syllables and voiced pitch track
+// together with the key it was made with. The key names the input files with their size and
+// modification time and the settings used, so changing either makes the cached file stale and it
+// is simply made again. Cache files are memory mapped when loaded.
+
+const std::string CACHE_FILE_SUFFIX = ".trk";
+
+// The key of an utterance made from the given input files with the given settings.
+// Returns an empty key if an input file can not be stat'ed, which is never cached.
+std::string cache_key(const std::vector<std::string> &input_paths, const std::string &settings);
+
+// Load the syllables and pitch track of an utterance from a cache file.
+// Returns false if there is no cache file, it was made with a different key or it is corrupt.
+bool load_cached_utt(const std::string &path, const std::string &key, typename utterance::utterance &utt);
+
+// Save the syllables and pitch track of an utterance to a cache file. The file is written under
+// a temporary name and renamed into place so a reader never sees half a file.
+// Throws if it can not be written.
+void save_cached_utt(const std::string &path, const std::string &key, typename utterance::utterance &utt);
+
+#endif
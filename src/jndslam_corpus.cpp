@@ -0,0 +1,712 @@
+/* Copyright 2015 Rasmus Dall - rasmus@dall.dk
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+#include "jndslam_corpus.h"
+
+// How many utterances each thread gets in a streaming window
+static const size_t STREAM_WINDOW_PER_THREAD = 8;
+
+// Find every file under a directory and its sub directories.
+// Each level of sub directories is scanned in parallel.
+static std::vector<std::string> scan_tree(const std::string &root, unsigned int threads)
+{
+  std::vector<std::string> files;
+  std::vector<std::string> level(1, root);
+  while (!level.empty())
+  {
+    std::vector<dir_listing> listings(level.size());
+    std::vector<size_t> order;
+    for (size_t i = 0; i < level.size(); i++)
+    {
+      order.push_back(i);
+    }
+    parallel_for(order, threads, [&](size_t i)
+    {
+      listings[i] = scan_dir(level[i]);
+    });
+    std::vector<std::string> next;
+    for (size_t i = 0; i < level.size(); i++)
+    {
+      for (size_t j = 0; j < listings[i].files.size(); j++)
+      {
+        files.push_back(join_path(level[i], listings[i].files[j]));
+      }
+      for (size_t j = 0; j < listings[i].dirs.size(); j++)
+      {
+        next.push_back(join_path(level[i], listings[i].dirs[j]));
+      }
+    }
+    level.swap(next);
+  }
+  std::sort(files.begin(), files.end());
+  return files;
+}
+
+// The name of a file without its directory
+static std::string file_name(const std::string &path)
+{
+  size_t slash = path.rfind('/');
+  return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+// Describe a list of files or problems, naming at most a few of them
+static std::string describe_list(const std::vector<std::string> &files)
+{
+  const size_t shown = 10;
+  std::string text;
+  for (size_t i = 0; i < files.size() && i < shown; i++)
+  {
+    text += (i > 0 ? ", " : "") + files[i];
+  }
+  if (files.size() > shown)
+  {
+    text += " and "+std::to_string(files.size() - shown)+" more";
+  }
+  return text;
+}
+
+// Match each lab file to a pitch file
+std::vector<utt_job> find_jobs(global_args_t &args)
+{
+  unsigned int threads = resolve_threads(args.threads);
+  std::vector<std::string> lab_files = scan_tree(args.lab_path, threads);
+  std::vector<std::string> pitch_files = scan_tree(args.pitch_path, threads);
+
+  // Index the pitch files by utterance name
+  std::unordered_map<std::string, size_t> pitch_index;
+  std::vector<std::string> duplicates;
+  for (size_t i = 0; i < pitch_files.size(); i++)
+  {
+    std::string name = file_name(pitch_files[i]);
+    if (name.size() <= 3 || name.compare(name.size() - 3, 3, ".f0") != 0)
+    {
+      continue;
+    }
+    if (!pitch_index.insert(std::make_pair(name.substr(0, name.size() - 3), i)).second)
+    {
+      duplicates.push_back(pitch_files[i]);
+    }
+  }
+
+  // The name of an utterance is its lab file name up to the first '.'
+  std::vector<utt_job> jobs;
+  std::vector<bool> pitch_used(pitch_files.size(), false);
+  std::vector<std::string> missing;
+  std::unordered_map<std::string, size_t> names;
+  for (size_t i = 0; i < lab_files.size(); i++)
+  {
+    utt_job job;
+    std::string name = file_name(lab_files[i]);
+    job.name = name.substr(0, name.find('.'));
+    job.lab_path = lab_files[i];
+    job.cost = 0;
+    if (!names.insert(std::make_pair(job.name, i)).second)
+    {
+      duplicates.push_back(lab_files[i]);
+      continue;
+    }
+    std::unordered_map<std::string, size_t>::iterator pitch = pitch_index.find(job.name);
+    if (pitch == pitch_index.end())
+    {
+      missing.push_back(lab_files[i]);
+      continue;
+    }
+    job.pitch_path = pitch_files[pitch->second];
+    pitch_used[pitch->second] = true;
+    jobs.push_back(job);
+  }
+
+  // Report every problem at once rather than one per run
+  if (!duplicates.empty())
+  {
+    throw std::invalid_argument(std::to_string(duplicates.size())+" files have the same utterance name as another: "+describe_list(duplicates));
+  }
+  if (!missing.empty())
+  {
+    throw std::invalid_argument(std::to_string(missing.size())+" lab files have no .f0 file in "+args.pitch_path+": "+describe_list(missing));
+  }
+  std::vector<std::string> unused;
+  for (std::unordered_map<std::string, size_t>::iterator it = pitch_index.begin(); it != pitch_index.end(); ++it)
+  {
+    if (!pitch_used[it->second])
+    {
+      unused.push_back(pitch_files[it->second]);
+    }
+  }
+  if (!unused.empty())
+  {
+    std::sort(unused.begin(), unused.end());
+    std::cerr << "WARNING! " << unused.size() << " .f0 files have no lab file and are ignored: " << describe_list(unused) << std::endl;
+  }
+
+  return jobs;
+}
+
+// Split a line into fields separated by spaces and tabs
+static void split_fields(text_view line, std::vector<text_view> &fields)
+{
+  fields.clear();
+  size_t pos = 0;
+  while (pos < line.size)
+  {
+    while (pos < line.size && (line.data[pos] == ' ' || line.data[pos] == '\t' || line.data[pos] == '\r'))
+    {
+      pos++;
+    }
+    size_t start = pos;
+    while (pos < line.size && line.data[pos] != ' ' && line.data[pos] != '\t' && line.data[pos] != '\r')
+    {
+      pos++;
+    }
+    if (pos > start)
+    {
+      fields.push_back(text_view(line.data + start, pos - start));
+    }
+  }
+}
+
+// Read the utterances to process from a manifest
+std::vector<utt_job> read_manifest(const std::string &path)
+{
+  mapped_file file(path);
+  text_view text = file.text();
+  std::vector<utt_job> jobs;
+  std::vector<text_view> fields;
+  std::vector<std::string> problems;
+  std::unordered_map<std::string, size_t> names;
+  text_view line;
+  for (size_t i = 0; next_line(text, line); i++)
+  {
+    split_fields(line, fields);
+    if (fields.empty() || fields[0].data[0] == '#')
+    {
+      continue;
+    }
+    if (fields.size() < 3 || fields.size() > 4)
+    {
+      problems.push_back("line "+std::to_string(i + 1)+" is malformed");
+      continue;
+    }
+    utt_job job;
+    job.name = fields[0].str();
+    job.lab_path = fields[1].str();
+    job.pitch_path = fields[2].str();
+    job.speaker = fields.size() == 4 ? fields[3].str() : std::string();
+    job.cost = 0;
+    if (!names.insert(std::make_pair(job.name, i)).second)
+    {
+      problems.push_back("line "+std::to_string(i + 1)+" repeats "+job.name);
+      continue;
+    }
+    jobs.push_back(job);
+  }
+  if (!problems.empty())
+  {
+    throw std::invalid_argument("Manifest "+path+" has "+std::to_string(problems.size())+" bad lines: "+describe_list(problems));
+  }
+  return jobs;
+}
+
+// Keep only the jobs of the utterances listed in a subset file
+void select_jobs(std::vector<utt_job> &jobs, const std::string &subset_path)
+{
+  mapped_file file(subset_path);
+  text_view text = file.text();
+  std::unordered_map<std::string, bool> wanted;
+  std::vector<text_view> fields;
+  text_view line;
+  while (next_line(text, line))
+  {
+    split_fields(line, fields);
+    if (!fields.empty() && fields[0].data[0] != '#')
+    {
+      wanted[fields[0].str()] = false;
+    }
+  }
+  std::vector<utt_job> selected;
+  for (size_t i = 0; i < jobs.size(); i++)
+  {
+    std::unordered_map<std::string, bool>::iterator it = wanted.find(jobs[i].name);
+    if (it != wanted.end())
+    {
+      it->second = true;
+      selected.push_back(jobs[i]);
+    }
+  }
+  std::vector<std::string> unknown;
+  for (std::unordered_map<std::string, bool>::iterator it = wanted.begin(); it != wanted.end(); ++it)
+  {
+    if (!it->second)
+    {
+      unknown.push_back(it->first);
+    }
+  }
+  if (!unknown.empty())
+  {
+    std::sort(unknown.begin(), unknown.end());
+    throw std::invalid_argument(std::to_string(unknown.size())+" utterances in "+subset_path+" have no input files: "+describe_list(unknown));
+  }
+  jobs.swap(selected);
+}
+
+// Find the jobs of a run
+std::vector<utt_job> load_jobs(global_args_t &args)
+{
+  std::vector<utt_job> jobs = args.manifest_path.empty() ? find_jobs(args) : read_manifest(args.manifest_path);
+  if (!args.subset_path.empty())
+  {
+    select_jobs(jobs, args.subset_path);
+  }
+  if (!args.speaker_pattern.empty())
+  {
+    std::regex pattern;
+    try
+    {
+      pattern = std::regex(args.speaker_pattern);
+    }
+    catch (const std::regex_error &e)
+    {
+      throw std::invalid_argument("Invalid speaker pattern "+args.speaker_pattern+": "+e.what());
+    }
+    std::vector<std::string> unmatched;
+    for (size_t i = 0; i < jobs.size(); i++)
+    {
+      if (!speaker_from_name(pattern, jobs[i].name, jobs[i].speaker))
+      {
+        unmatched.push_back(jobs[i].name);
+      }
+    }
+    if (!unmatched.empty())
+    {
+      throw std::invalid_argument(std::to_string(unmatched.size())+" utterance names do not match the speaker pattern "+args.speaker_pattern+": "+describe_list(unmatched));
+    }
+  }
+  
+  // The size of the pitch file decides how much smoothing there is to do. It is only needed to
+  // start the longest utterances first so a single thread saves the stat of every file.
+  unsigned int threads = resolve_threads(args.threads);
+  if (threads > 1)
+  {
+    std::vector<size_t> order;
+    for (size_t i = 0; i < jobs.size(); i++)
+    {
+      order.push_back(i);
+    }
+    parallel_for(order, threads, [&](size_t i)
+    {
+      struct stat p;
+      if (stat(jobs[i].pitch_path.c_str(), &p) == 0)
+      {
+        jobs[i].cost = p.st_size;
+      }
+    });
+  }
+  return jobs;
+}
+
+// Parse the text of a lab and pitch file into an utterance and smooth it
+void parse_utt(typename utterance::utterance &utt, text_view lab, text_view pitch, global_args_t &args, smooth_stats &stats)
+{
+  // Add segment info to utterance from input lab file
+  if (args.lab_type == "simple")
+  {
+    parse_simple_lab(utt, lab);
+  }
+  else if (args.lab_type == "hts")
+  {
+    parse_hts_lab(utt, lab, args.hts_delims);
+  }
+  else
+  {
+    throw std::invalid_argument("Input type is of unrecognised type "+args.lab_type+". Exiting.");
+  }
+
+  // Add pitch information to utterance from EST file
+  parse_est(utt, pitch);
+
+  // Smooth pitch for each segment if applicable
+  if (args.smoothing)
+  {
+    smooth_utt(utt, args.smoothing_params, stats);
+  }
+  else
+  {
+    remove_unvoiced_utt(utt);
+  }
+}
+
+// The settings that change a parsed and smoothed utterance. The instruction set is left out as
+// every one gives the same result. Numbers are written in hex so they are exact.
+static std::string cache_settings(global_args_t &args)
+{
+  smooth_params &params = args.smoothing_params;
+  char buffer[256];
+  snprintf(buffer, sizeof(buffer), "smoothing %d span %a iters %u tolerance %a ignore_unvoiced %d delta %a float %d scope %d\n",
+           args.smoothing, params.span, params.iters, params.tolerance, params.ignore_unvoiced, params.delta, params.single_precision, params.scope);
+  std::string settings = "labs "+args.lab_type;
+  for (size_t i = 0; i < args.hts_delims.delims.size(); i++)
+  {
+    settings += " "+args.hts_delims.delims[i];
+  }
+  return settings+"\n"+buffer;
+}
+
+// Open, parse and smooth the input files of a job into an utterance
+void load_utt(typename utterance::utterance &utt, utt_job &job, global_args_t &args, smooth_stats &stats)
+{
+  std::string key;
+  std::string cache_path;
+  if (!args.cache_path.empty())
+  {
+    std::vector<std::string> inputs = {job.lab_path, job.pitch_path};
+    key = cache_key(inputs, cache_settings(args));
+    cache_path = join_path(args.cache_path, job.name + CACHE_FILE_SUFFIX);
+    if (load_cached_utt(cache_path, key, utt))
+    {
+      return void();
+    }
+  }
+  
+  mapped_file lab_file(job.lab_path);
+  mapped_file pitch_file(job.pitch_path);
+  parse_utt(utt, lab_file.text(), pitch_file.text(), args, stats);
+  
+  // A cache that can not be written only costs the time it would have saved
+  if (!cache_path.empty())
+  {
+    try
+    {
+      save_cached_utt(cache_path, key, utt);
+    }
+    catch (const std::exception &e)
+    {
+      std::cerr << "WARNING! " << e.what() << ". Not caching " << job.name << "." << std::endl;
+    }
+  }
+}
+
+// Where the output of an algorithm goes
+std::string style_out_path(global_args_t &args, Style_Alg algorithm)
+{
+  if (args.algorithms.size() == 1)
+  {
+    return args.out_path;
+  }
+  return args.out_path+style_alg_to_string(algorithm)+"/";
+}
+
+// Create the output sub directories of each algorithm
+void make_style_dirs(global_args_t &args)
+{
+  if (args.algorithms.size() == 1 || args.out_path == STDOUT_PATH)
+  {
+    return void();
+  }
+  for (size_t i = 0; i < args.algorithms.size(); i++)
+  {
+    std::string dir = style_out_path(args, args.algorithms[i]);
+    if (mkdir(dir.c_str(), 0777) != 0 && errno != EEXIST)
+    {
+      throw std::invalid_argument("Could not create output dir "+dir+": "+strerror(errno));
+    }
+  }
+}
+
+// Create the cache dir if there is one
+void make_cache_dir(global_args_t &args)
+{
+  if (!args.cache_path.empty() && mkdir(args.cache_path.c_str(), 0777) != 0 && errno != EEXIST)
+  {
+    throw std::invalid_argument("Could not create cache dir "+args.cache_path+": "+strerror(errno));
+  }
+}
+
+corpus_output::corpus_output(global_args_t &args, std::vector<utt_job> &jobs) : args(args), jobs(jobs)
+{
+  if (args.format == FORMAT_BINARY)
+  {
+    for (size_t a = 0; a < args.algorithms.size(); a++)
+    {
+      builders.push_back(styb_builder(args.algorithms[a], jobs.size()));
+    }
+  }
+  else if (args.format == FORMAT_NDJSON && args.out_path == STDOUT_PATH)
+  {
+    streams.push_back(new record_writer(STDOUT_PATH));
+  }
+  else if (args.format == FORMAT_NDJSON)
+  {
+    for (size_t a = 0; a < args.algorithms.size(); a++)
+    {
+      streams.push_back(new record_writer(style_out_path(args, args.algorithms[a]) + NDJSON_FILE_NAME));
+    }
+  }
+}
+
+corpus_output::~corpus_output()
+{
+  for (size_t s = 0; s < streams.size(); s++)
+  {
+    delete streams[s];
+  }
+}
+
+// Output the stylisation of utterance i with algorithm number a
+void corpus_output::add(size_t i, typename utterance::utterance &utt, size_t a)
+{
+  if (args.format == FORMAT_BINARY)
+  {
+    builders[a].add_utt(i, utt);
+  }
+  else if (args.format == FORMAT_NDJSON)
+  {
+    std::string record;
+    format_utt_json(utt, args.algorithms[a], record);
+    // A single stream holds every algorithm of an utterance one after the other
+    // and indexes them by utterance and algorithm
+    if (streams.size() == 1 && args.algorithms.size() > 1)
+    {
+      streams[0]->add(i * args.algorithms.size() + a, utt.name + "/" + style_alg_to_string(args.algorithms[a]), record);
+    }
+    else if (streams.size() == 1)
+    {
+      streams[0]->add(i, utt.name, record);
+    }
+    else
+    {
+      streams[a]->add(i, utt.name, record);
+    }
+  }
+  else if (args.format == FORMAT_LAB)
+  {
+    add_lab(i, utt, a);
+  }
+  else
+  {
+    std::string buffer = writer.take_buffer();
+    format_utt(utt, args.algorithms[a], buffer);
+    writer.submit(style_out_path(args, args.algorithms[a]) + utt.name + ".sty", buffer);
+  }
+}
+
+// Output the HTS label of utterance i with the style of an algorithm added
+void corpus_output::add_lab(size_t i, typename utterance::utterance &utt, size_t a)
+{
+  mapped_file lab_file(jobs[i].lab_path);
+  // An utterance loaded from the cache was not parsed so its phones are found again
+  if (utt.phones.empty())
+  {
+    typename utterance::utterance parsed(utt.name);
+    parse_hts_lab(parsed, lab_file.text(), args.hts_delims);
+    utt.phones.swap(parsed.phones);
+  }
+  std::string buffer = writer.take_buffer();
+  format_style_lab(utt, args.algorithms[a], lab_file.text(), args.lab_block, buffer);
+  writer.submit(style_out_path(args, args.algorithms[a]) + utt.name + ".lab", buffer);
+}
+
+// Write out everything and wait for it
+void corpus_output::finish()
+{
+  for (size_t a = 0; a < builders.size(); a++)
+  {
+    builders[a].write(style_out_path(args, args.algorithms[a]) + STYB_FILE_NAME, writer);
+  }
+  for (size_t s = 0; s < streams.size(); s++)
+  {
+    streams[s]->finish();
+    if (args.out_path != STDOUT_PATH)
+    {
+      streams[s]->write_index(style_out_path(args, args.algorithms[s]) + NDJSON_FILE_NAME + INDEX_SUFFIX);
+    }
+    else if (!args.index_path.empty())
+    {
+      streams[s]->write_index(args.index_path);
+    }
+  }
+  size_t failures = writer.finish();
+  if (failures > 0)
+  {
+    throw std::runtime_error(std::to_string(failures)+" output files could not be written");
+  }
+}
+
+// Stylise utterance i with every algorithm and output each to its own destination
+void stylise_and_write_utt(typename utterance::utterance &utt, size_t i, global_args_t &args, float mean_pitch, corpus_output &output)
+{
+  std::vector<contour_stats> contours;
+  find_contours(utt, mean_pitch, contours);
+  for (size_t a = 0; a < args.algorithms.size(); a++)
+  {
+    style_contours(utt, contours, args.algorithms[a]);
+    output.add(i, utt, a);
+  }
+}
+
+// Add the smoothing stats of one utterance to a shared total
+static void add_shared_stats(smooth_stats &total, const smooth_stats &part, std::mutex &lock)
+{
+  std::lock_guard<std::mutex> guard(lock);
+  add_smooth_stats(total, part);
+}
+
+// Order a range of jobs longest first
+static std::vector<size_t> order_jobs(std::vector<utt_job> &jobs, size_t start, size_t end)
+{
+  std::vector<size_t> costs;
+  for (size_t i = start; i < end; i++)
+  {
+    costs.push_back(jobs[i].cost);
+  }
+  return longest_first(costs);
+}
+
+// Add the pitch sums of a range of jobs, starting at job start, to the stats of their speakers.
+// The sums are added in corpus order so the result does not depend on the number of threads.
+static void add_speaker_sums(speaker_stats &reference, std::vector<utt_job> &jobs, size_t start, std::vector<pitch_sum> &sums)
+{
+  for (size_t i = 0; i < sums.size(); i++)
+  {
+    pitch_sum &total = reference.insert(std::make_pair(jobs[start + i].speaker, pitch_sum())).first->second;
+    add_pitch_sum(total, sums[i]);
+  }
+}
+
+// Load the reference stats if asked to. Returns false if they must be found from the corpus.
+static bool load_reference(global_args_t &args, speaker_stats &reference)
+{
+  if (args.load_stats_path.empty())
+  {
+    return false;
+  }
+  reference = load_speaker_stats(args.load_stats_path);
+  return true;
+}
+
+// Save the reference stats if asked to and find the mean pitch of every job.
+// Throws listing every speaker without stats.
+static std::vector<float> job_mean_pitches(global_args_t &args, std::vector<utt_job> &jobs, speaker_stats &reference)
+{
+  if (!args.save_stats_path.empty())
+  {
+    save_speaker_stats(args.save_stats_path, reference);
+  }
+  std::vector<float> means(jobs.size());
+  std::vector<std::string> unknown;
+  for (size_t i = 0; i < jobs.size(); i++)
+  {
+    if (reference.count(jobs[i].speaker) == 0)
+    {
+      unknown.push_back(jobs[i].speaker.empty() ? NO_SPEAKER_NAME : jobs[i].speaker);
+      reference[jobs[i].speaker] = pitch_sum();
+      continue;
+    }
+    means[i] = speaker_mean_pitch(reference, jobs[i].speaker);
+  }
+  if (!unknown.empty())
+  {
+    throw std::invalid_argument(std::to_string(unknown.size())+" speakers have no reference pitch in "+args.load_stats_path+": "+describe_list(unknown));
+  }
+  return means;
+}
+
+// Process a corpus with every utterance kept in memory until all are written
+void process_corpus(std::vector<utt_job> &jobs, global_args_t &args, smooth_stats &stats)
+{
+  std::mutex stats_lock;
+  unsigned int threads = resolve_threads(args.threads);
+  // Start the longest utterances first so they do not hold up the end of the run
+  std::vector<size_t> order = order_jobs(jobs, 0, jobs.size());
+
+  // Ready a list of utts
+  std::vector<typename utterance::utterance> utts;
+  for (size_t i = 0; i < jobs.size(); i++)
+  {
+    utts.push_back(typename utterance::utterance(jobs[i].name));
+  }
+
+  parallel_for(order, threads, [&](size_t i)
+  {
+    smooth_stats utt_stats;
+    load_utt(utts[i], jobs[i], args, utt_stats);
+    add_shared_stats(stats, utt_stats, stats_lock);
+  });
+
+  // Get the mean f0 of each speaker. Each utterance is summed separately and the sums
+  // combined in order so the mean does not depend on the number of threads.
+  speaker_stats reference;
+  if (!load_reference(args, reference))
+  {
+    std::vector<pitch_sum> sums(utts.size());
+    parallel_for(order, threads, [&](size_t i)
+    {
+      sums[i] = calc_pitch_sum(utts[i]);
+    });
+    add_speaker_sums(reference, jobs, 0, sums);
+  }
+  std::vector<float> means = job_mean_pitches(args, jobs, reference);
+
+  // Stylise syllables and write output stylisation
+  corpus_output output(args, jobs);
+  parallel_for(order, threads, [&](size_t i)
+  {
+    stylise_and_write_utt(utts[i], i, args, means[i], output);
+  });
+  output.finish();
+}
+
+// Process a corpus a window of utterances at a time
+void stream_corpus(std::vector<utt_job> &jobs, global_args_t &args, smooth_stats &stats)
+{
+  std::mutex stats_lock;
+  unsigned int threads = resolve_threads(args.threads);
+  size_t window = threads * STREAM_WINDOW_PER_THREAD;
+
+  // First pass, find the mean pitch of each speaker unless it is known.
+  // The sums are added in corpus order so the mean is the same as when all utterances are in memory.
+  speaker_stats reference;
+  bool loaded = load_reference(args, reference);
+  for (size_t start = 0; start < jobs.size() && !loaded; start += window)
+  {
+    size_t end = std::min(start + window, jobs.size());
+    std::vector<size_t> order = order_jobs(jobs, start, end);
+    std::vector<pitch_sum> sums(end - start);
+    parallel_for(order, threads, [&](size_t i)
+    {
+      typename utterance::utterance utt(jobs[start + i].name);
+      smooth_stats first_pass_stats;
+      load_utt(utt, jobs[start + i], args, first_pass_stats);
+      sums[i] = calc_pitch_sum(utt);
+    });
+    add_speaker_sums(reference, jobs, start, sums);
+  }
+  std::vector<float> means = job_mean_pitches(args, jobs, reference);
+
+  // Second pass, stylise and write out each utterance as soon as it is ready
+  corpus_output output(args, jobs);
+  for (size_t start = 0; start < jobs.size(); start += window)
+  {
+    size_t end = std::min(start + window, jobs.size());
+    std::vector<size_t> order = order_jobs(jobs, start, end);
+    parallel_for(order, threads, [&](size_t i)
+    {
+      typename utterance::utterance utt(jobs[start + i].name);
+      smooth_stats utt_stats;
+      load_utt(utt, jobs[start + i], args, utt_stats);
+      add_shared_stats(stats, utt_stats, stats_lock);
+      stylise_and_write_utt(utt, start + i, args, means[start + i], output);
+    });
+  }
+  output.finish();
+}
@@ -0,0 +1,176 @@
+/* Copyright 2015 Rasmus Dall - rasmus@dall.dk
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+#ifndef JNDSLAM_CORPUS_H
+#define JNDSLAM_CORPUS_H
+
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <mutex>
+#include <algorithm>
+#include <unordered_map>
+
+#include <sys/stat.h>
+#include <errno.h>
+#include <string.h>
+
+#include "utterance.h"
+#include "jndslam_io.h"
+#include "jndslam_std.h"
+#include "jndslam_style.h"
+#include "jndslam_smooth.h"
+#include "jndslam_parallel.h"
+#include "jndslam_writer.h"
+#include "jndslam_binary.h"
+#include "jndslam_cache.h"
+#include "jndslam_speaker.h"
+
+// The formats stylisations can be written in
+enum Output_Format {FORMAT_TEXT, FORMAT_BINARY, FORMAT_NDJSON, FORMAT_LAB};
+
+// The name of the binary stylisation file in the output dir of each algorithm
+const std::string STYB_FILE_NAME = "stylisation.styb";
+
+// The name of the file of JSON records in the output dir of each algorithm.
+// Its index is written next to it with INDEX_SUFFIX added.
+const std::string NDJSON_FILE_NAME = "stylisation.ndjson";
+const std::string INDEX_SUFFIX = ".idx";
+
+// The output path that writes to stdout
+const std::string STDOUT_PATH = "-";
+
+// Global argument container
+struct global_args_t
+{
+  bool smoothing;              // Are we smoothing?
+  std::vector<Style_Alg> algorithms;  // Stylisation algorithms to use
+  hts_delimiters hts_delims;   // Delimiters of the fields of HTS labels
+  std::string lab_type;        // What type of input are we receiving?
+  std::string lab_path;        // Where can we find the .lab files?
+  std::string pitch_path;      // Where can we find the .f0 files?
+  std::string manifest_path;   // File listing the utterances and their input files, used instead of the dirs if given
+  std::string subset_path;     // File listing the utterances to process, empty for all
+  std::string cache_path;      // Dir of cached parsed and smoothed utterances, empty for no cache
+  std::string speaker_pattern; // Pattern finding the speaker in an utterance name, empty to use the manifest
+  std::string load_stats_path; // Stats file to take the reference pitch of each speaker from instead of the corpus
+  std::string save_stats_path; // Stats file to save the reference pitch of each speaker to
+  std::string out_path;      // Where shall we put the output files?
+  Output_Format format;        // How to write the output
+  std::string index_path;      // Where to write the record index when writing to stdout, empty for none
+  std::string lab_block;       // Start of the style block added to each context of HTS labels written out
+  unsigned int threads;        // How many utterances to process in parallel
+  bool streaming;              // Process the corpus a window of utterances at a time?
+  smooth_params smoothing_params;  // How to smooth
+  bool smooth_stats;           // Report how much smoothing work was done?
+};
+
+// An utterance to be processed and where to find its input files
+struct utt_job
+{
+  std::string name;
+  std::string lab_path;
+  std::string pitch_path;
+  std::string speaker;         // Empty if unknown
+  size_t cost;                 // Rough amount of work, used for scheduling the longest first
+};
+
+// Match each lab file under the lab dir to the .f0 file of the same name under the pitch dir.
+// Both dirs are searched with their sub directories, scanned in parallel, so a corpus can be split
+// into shards. Jobs are sorted by lab path. Throws listing every lab file without a pitch file and
+// every utterance name found twice. Pitch files without a lab file are reported on stderr.
+std::vector<utt_job> find_jobs(global_args_t &args);
+
+// Read the utterances to process from a manifest without looking at any directory.
+// Each line is "id lab_path f0_path [speaker]" separated by spaces or tabs. Empty lines and lines
+// starting with # are skipped. Jobs keep the order of the manifest. Throws listing every malformed
+// line and every id given twice.
+std::vector<utt_job> read_manifest(const std::string &path);
+
+// Keep only the jobs of the utterances listed, one id per line, in a subset file.
+// Jobs keep their order. Throws listing every id in the subset that is not a job.
+void select_jobs(std::vector<utt_job> &jobs, const std::string &subset_path);
+
+// Find the jobs of a run from the manifest or the input dirs, keep those of the subset if there
+// is one, find the speaker of each from its name if there is a speaker pattern and find the cost
+// of each if they are to be run in parallel. Throws listing every name the pattern does not match.
+std::vector<utt_job> load_jobs(global_args_t &args);
+
+// Parse the text of a lab and pitch file into an utterance and smooth it
+void parse_utt(typename utterance::utterance &utt, text_view lab, text_view pitch, global_args_t &args, smooth_stats &stats);
+
+// Open, parse and smooth the input files of a job into an utterance.
+// With a cache dir the utterance is loaded from it if it was cached from the same input files
+// with the same settings, and cached after smoothing if not. No smoothing work is done for an
+// utterance loaded from the cache so it adds nothing to stats.
+void load_utt(typename utterance::utterance &utt, utt_job &job, global_args_t &args, smooth_stats &stats);
+
+// Where the output of an algorithm goes. With a single algorithm it is the output dir,
+// with several each gets a sub directory of it named after the algorithm.
+std::string style_out_path(global_args_t &args, Style_Alg algorithm);
+
+// Create the output sub directories of each algorithm if there are several. Throws if one can not be made.
+void make_style_dirs(global_args_t &args);
+
+// Create the cache dir if there is one and it does not exist. Throws if it can not be made.
+void make_cache_dir(global_args_t &args);
+
+// Where the stylisations of a corpus go. Text is written a file per utterance as soon as it is ready
+// and so are HTS labels with the style added, copied from the lab file of the job of the utterance.
+// Binary output is collected and written as one file per algorithm by finish().
+// JSON records are written in corpus order to one file per algorithm, or all to stdout with
+// the records of each utterance in the order of the algorithms. A stream holding several
+// algorithms is indexed by utterance/algorithm, e.g. arctic_a0001/slam.
+// Files are written on a background thread and records as soon as those before them are ready.
+class corpus_output
+{
+public:
+  corpus_output(global_args_t &args, std::vector<utt_job> &jobs);
+  ~corpus_output();
+  // Output the stylisation of utterance i with algorithm number a of args.algorithms.
+  // Different utterances can be output from different threads.
+  void add(size_t i, typename utterance::utterance &utt, size_t a);
+  // Write out everything and wait for it. Throws if any output could not be written.
+  void finish();
+private:
+  // The output owns its record writers so it can not be copied
+  corpus_output(const corpus_output &other);
+  corpus_output &operator=(const corpus_output &other);
+  // Output the HTS label of utterance i with the style of algorithm number a added
+  void add_lab(size_t i, typename utterance::utterance &utt, size_t a);
+  global_args_t &args;
+  std::vector<utt_job> &jobs;
+  std::vector<styb_builder> builders;
+  std::vector<record_writer *> streams;
+  file_writer writer;
+};
+
+// Stylise utterance i with every algorithm and output each to its own destination.
+// The utterance is converted to semitones and its contours found only once.
+void stylise_and_write_utt(typename utterance::utterance &utt, size_t i, global_args_t &args, float mean_pitch, corpus_output &output);
+
+// Each utterance is stylised relative to the mean pitch of its speaker. The means are loaded from
+// args.load_stats_path if given and otherwise found from the corpus, and saved if asked to.
+
+// Process a corpus with every utterance kept in memory until all are written.
+// The smoothing work done is added to stats. Output is written on a background thread.
+// Throws once everything else is written if an output file could not be written.
+void process_corpus(std::vector<utt_job> &jobs, global_args_t &args, smooth_stats &stats);
+
+// Process a corpus a window of utterances at a time so memory does not grow with the size of the corpus.
+// A first pass finds the mean pitch of each speaker, unless loaded, and a second pass stylises and writes each window.
+// Output is identical to process_corpus. Only the smoothing work of the second pass is added to stats.
+void stream_corpus(std::vector<utt_job> &jobs, global_args_t &args, smooth_stats &stats);
+
+#endif
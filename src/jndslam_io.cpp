@@ -34,7 +34,7 @@ std::vector<std::string> list_dir(std::string dir)
   struct dirent *dirp;
   if((dr  = opendir(dir.c_str())) == NULL)
   {
-    std::cerr << "Error(" << errno << ") opening " << dir << "\n";
+    throw std::invalid_argument("Could not open directory "+dir+": "+strerror(errno));
   }
 
   while ((dirp = readdir(dr)) != NULL)
@@ -54,175 +54,510 @@ std::vector<std::string> list_dir(std::string dir)
   return files;
 }
 
-// Open a file line by line
-std::vector<std::string> open_file(std::string filepath)
+// List a directory by the entry types readdir reports
+dir_listing scan_dir(const std::string &dir)
 {
-  //Lets first check if the file exists at all. If not we die.
-  if (!file_exists(filepath))
+  dir_listing listing;
+  DIR *dr = opendir(dir.c_str());
+  if (dr == NULL)
+  {
+    throw std::invalid_argument("Could not open directory "+dir+": "+strerror(errno));
+  }
+  struct dirent *dirp;
+  while ((dirp = readdir(dr)) != NULL)
+  {
+    const char *name = dirp->d_name;
+    size_t length = strlen(name);
+    // Skips . and .. too
+    if (length == 0 || name[0] == '.' || name[length - 1] == '~')
+    {
+      continue;
+    }
+    unsigned char type = dirp->d_type;
+    if (type == DT_UNKNOWN || type == DT_LNK)
+    {
+      struct stat s;
+      if (fstatat(dirfd(dr), name, &s, 0) != 0)
+      {
+        continue;
+      }
+      if (S_ISREG(s.st_mode))
+      {
+        type = DT_REG;
+      }
+      else if (S_ISDIR(s.st_mode) && type == DT_UNKNOWN)
+      {
+        type = DT_DIR;
+      }
+    }
+    if (type == DT_REG)
+    {
+      listing.files.push_back(std::string(name, length));
+    }
+    else if (type == DT_DIR)
+    {
+      listing.dirs.push_back(std::string(name, length));
+    }
+  }
+  closedir(dr);
+  return listing;
+}
+
+// Join a directory and a name in it
+std::string join_path(const std::string &dir, const std::string &name)
+{
+  if (dir.empty() || dir.back() == '/')
+  {
+    return dir + name;
+  }
+  return dir + "/" + name;
+}
+
+// Map a file into memory
+mapped_file::mapped_file(const std::string &filepath, bool sequential)
+{
+  this->data = NULL;
+  this->size = 0;
+  int fd = open(filepath.c_str(), O_RDONLY);
+  if (fd == -1)
   {
     throw std::invalid_argument("File does not exist: "+filepath);
   }
-  std::ifstream f;
-  f.open(filepath.c_str(), std::ifstream::in);
-  std::string str;
-  
-  std::vector<std::string> out_vec;
-  
-  while (f.good())
+  struct stat s;
+  if (fstat(fd, &s) == -1)
   {
-    std::getline(f, str);
-    out_vec.push_back(str);
+    close(fd);
+    throw std::runtime_error("Could not stat file: "+filepath);
   }
-  
-  return out_vec;
+  // An empty file cannot be mapped but is simply an empty view
+  if (s.st_size > 0)
+  {
+    void *mapping = mmap(NULL, s.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapping == MAP_FAILED)
+    {
+      close(fd);
+      throw std::runtime_error("Could not map file: "+filepath);
+    }
+    // Tell the kernel whether to read ahead
+    madvise(mapping, s.st_size, sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+    this->data = (const char *)mapping;
+    this->size = s.st_size;
+  }
+  // The mapping stays valid after the file is closed
+  close(fd);
+}
+
+mapped_file::~mapped_file()
+{
+  if (this->data != NULL)
+  {
+    munmap((void *)this->data, this->size);
+  }
+}
+
+text_view mapped_file::text() const
+{
+  return text_view(this->data, this->size);
+}
+
+// The details we need from the header of an EST track
+struct est_header
+{
+  bool binary;            // Are frames stored as binary floats rather than ascii lines?
+  bool swap;              // Are binary floats in the opposite byte order of this machine?
+  int num_frames;
+  int num_channels;
+};
+
+// Is this machine big endian?
+static bool is_big_endian()
+{
+  const unsigned int one = 1;
+  return *(const unsigned char *)&one == 0;
+}
+
+// Read the header of an EST track from the front of text. Leaves text at the first frame.
+static est_header parse_est_header(text_view &text, std::string &name)
+{
+  est_header header = {false, false, -1, 1};
+  std::vector<text_view> tmp_vec;
+  text_view line;
+  bool first = true;
+  while (next_line(text, line))
+  {
+    split_view(line, tmp_vec);
+    if (tmp_vec.empty())
+    {
+      continue;
+    }
+    if (first && !(tmp_vec[0] == "EST_File"))
+    {
+      throw std::invalid_argument("Pitch file for "+name+" is not an EST file.");
+    }
+    first = false;
+    if (tmp_vec[0] == "EST_Header_End")
+    {
+      return header;
+    }
+    if (tmp_vec.size() < 2)
+    {
+      continue;
+    }
+    if (tmp_vec[0] == "DataType")
+    {
+      if (tmp_vec[1] == "binary")
+      {
+        header.binary = true;
+      }
+      else if (!(tmp_vec[1] == "ascii"))
+      {
+        throw std::invalid_argument("Pitch file for "+name+" has unsupported DataType "+tmp_vec[1].str()+".");
+      }
+    }
+    else if (tmp_vec[0] == "ByteOrder")
+    {
+      // EST writes 10 for most significant byte first and 01 for least significant byte first
+      bool file_big_endian = tmp_vec[1] == "10";
+      header.swap = file_big_endian != is_big_endian();
+    }
+    else if (tmp_vec[0] == "NumFrames")
+    {
+      header.num_frames = view_to_int(tmp_vec[1]);
+    }
+    else if (tmp_vec[0] == "NumChannels")
+    {
+      header.num_channels = view_to_int(tmp_vec[1]);
+    }
+  }
+  throw std::invalid_argument("Pitch file for "+name+" has no EST_Header_End.");
+}
+
+// Read a binary float which may need its bytes swapped
+static float read_binary_float(const char *data, bool swap)
+{
+  char bytes[sizeof(float)];
+  std::memcpy(bytes, data, sizeof(float));
+  if (swap)
+  {
+    std::reverse(bytes, bytes + sizeof(float));
+  }
+  float value;
+  std::memcpy(&value, bytes, sizeof(float));
+  return value;
 }
 
 // Parse an EST file and add the pitch information to all sylls in an utt.
-void parse_est(typename utterance::utterance &utt, std::vector<std::string> &line_list)
+void parse_est(typename utterance::utterance &utt, text_view text)
 {
-  // For string splitting
-  std::vector<std::string> tmp_vec;
   // For keeping time, voicing and pitch values
-  std::vector<std::vector<float> > time_vec;
-  std::vector<float> tmp_time_vec;
+  pitch_track &frames = utt.frames;
+  frames.clear();
   
-  // Go through each line and find timing
-  // We start at int = 7 as we wish to ignore the header lines (the first 7 lines)
-  for (int i = 7; i < line_list.size(); i++)
+  est_header header = parse_est_header(text, utt.name);
+  if (header.num_channels < 1)
   {
-    // Split it in times, voicing and pitch value
-    tmp_vec = split_string(line_list[i], ' ',false);
-    // Make sure we have enough values
-    if (tmp_vec.size() == 3)
+    throw std::invalid_argument("Pitch file for "+utt.name+" has no channels.");
+  }
+  // Each frame is a time, a voicing value and a value for each channel. The pitch is the first channel.
+  const size_t frame_values = 2 + header.num_channels;
+  
+  if (header.binary)
+  {
+    const size_t frame_bytes = frame_values * sizeof(float);
+    size_t num_frames = text.size / frame_bytes;
+    if (header.num_frames >= 0 && header.num_frames < num_frames)
+    {
+      num_frames = header.num_frames;
+    }
+    else if (header.num_frames > num_frames)
     {
-      tmp_time_vec.clear();
-      for (int j = 0; j < 3; j++)
+      std::cerr << "WARNING! Pitch file for " << utt.name << " should have " << header.num_frames << " frames but only has " << num_frames << ".\n";
+    }
+    frames.reserve(num_frames);
+    for (size_t i = 0; i < num_frames; i++)
+    {
+      const char *frame = text.data + i * frame_bytes;
+      frames.push_back(read_binary_float(frame, header.swap),
+                       read_binary_float(frame + sizeof(float), header.swap),
+                       read_binary_float(frame + 2 * sizeof(float), header.swap));
+    }
+  }
+  else
+  {
+    if (header.num_frames > 0)
+    {
+      frames.reserve(header.num_frames);
+    }
+    // For string splitting
+    std::vector<text_view> tmp_vec;
+    // Go through each line and find timing
+    text_view line;
+    while (next_line(text, line))
+    {
+      // Split it in times, voicing and pitch value
+      split_view(line, tmp_vec, ' ', false);
+      // Make sure we have enough values
+      if (tmp_vec.size() == frame_values)
       {
-        tmp_time_vec.push_back(std::atof(tmp_vec[j].c_str()));
+        frames.push_back(view_to_float(tmp_vec[0]), view_to_float(tmp_vec[1]), view_to_float(tmp_vec[2]));
       }
-      time_vec.push_back(tmp_time_vec);
     }
   }
   
   // Go through each syllable in utt and match with pitch values
   for (int i = 0; i < utt.sylls.size(); i++)
   {
-    // We here assume a framesize of 5ms
-    int start_frame = utt.sylls[i].start / 0.005;
-    int end_frame = utt.sylls[i].end / 0.005;
-    // The start should be floored only for the first syllable
-    if (start_frame != 0)
+    if (!segment_frame_range(utt.sylls[i].start, utt.sylls[i].end, frames.size(), utt.sylls[i].frames_begin, utt.sylls[i].frames_end))
     {
-      start_frame += 1;
+      std::cerr << "WARNING! Out of Range when getting slice from " << utt.sylls[i].start << "s to " << utt.sylls[i].end << "s in " << utt.name << ". Only " << frames.size() << " frames exist. Skipping..\n";
     }
-    // Obtain the slice of the pitch values and add it to the syll
-    utt.sylls[i].pitch_values = slice_vector(time_vec, start_frame, end_frame);
   }
 }
 
-// Parse a list of hts full-context phone labels and add syllables to an utt
-void parse_hts_lab(typename utterance::utterance &utt, std::vector<std::string> &line_list, std::vector<std::string> &delims)
+// Find the frames of a segment in a track of 5ms frames
+bool segment_frame_range(float start, float end, size_t num_frames, size_t &frames_begin, size_t &frames_end)
+{
+  // We here assume a framesize of 5ms
+  long start_frame = start / 0.005;
+  long end_frame = end / 0.005;
+  // The start should be floored only for the first syllable
+  if (start_frame != 0)
+  {
+    start_frame += 1;
+  }
+  // The syllable gets the frames from start_frame to end_frame inclusive.
+  // Frames past the end of the track are left out.
+  bool in_range = end_frame < (long)num_frames;
+  if (!in_range)
+  {
+    end_frame = (long)num_frames - 1;
+  }
+  start_frame = std::max(start_frame, 0L);
+  if (start_frame > end_frame + 1)
+  {
+    start_frame = end_frame + 1;
+  }
+  frames_begin = start_frame;
+  frames_end = std::max(end_frame + 1, start_frame);
+  return in_range;
+}
+
+hts_delimiters::hts_delimiters()
+{
+  this->starts.fill(0);
+}
+
+hts_delimiters::hts_delimiters(const std::vector<std::string> &delims)
 {
   //  Must be of right size
   if (delims.size() != 4)
   {
     throw std::invalid_argument("Wrong number of delimiters for parse_hts_lab. Exiting.");
   }
+  this->delims = delims;
+  this->starts.fill(0);
+  for (size_t k = 0; k < delims.size(); k++)
+  {
+    if (delims[k].empty())
+    {
+      throw std::invalid_argument("HTS delimiters can not be empty.");
+    }
+    this->starts[(unsigned char)delims[k][0]] |= 1 << k;
+  }
+}
+
+// Cut the next space separated field from the front of text. Returns false if there is none.
+static bool next_field(text_view &text, text_view &field)
+{
+  const char *end = text.data + text.size;
+  const char *begin = text.data;
+  while (begin < end && *begin == ' ')
+  {
+    begin++;
+  }
+  if (begin == end)
+  {
+    return false;
+  }
+  const char *space = (const char *)memchr(begin, ' ', end - begin);
+  if (space == NULL)
+  {
+    space = end;
+  }
+  field = text_view(begin, space - begin);
+  text = text_view(space, end - space);
+  return true;
+}
+
+// Find the phone identity and the syllable position in the context of an HTS label in a single pass.
+// Each is between the first occurrence of its left delimiter and the first of its right delimiter after that.
+// Returns false if a delimiter is missing.
+static bool find_hts_fields(text_view context, const hts_delimiters &delims, text_view &phone, text_view &position)
+{
+  size_t found[4];
+  // Where the text after each left delimiter begins
+  size_t after[2] = {0, 0};
+  unsigned int missing = 0xF;
+  for (size_t i = 0; i < context.size && missing != 0; i++)
+  {
+    unsigned int candidates = delims.starts[(unsigned char)context.data[i]] & missing;
+    for (unsigned int k = 0; candidates != 0; k++, candidates >>= 1)
+    {
+      if ((candidates & 1) == 0)
+      {
+        continue;
+      }
+      // A right delimiter only counts after its left one
+      if (k % 2 == 1 && ((missing & (1 << (k - 1))) != 0 || i < after[k / 2]))
+      {
+        continue;
+      }
+      const std::string &delim = delims.delims[k];
+      if (delim.size() <= context.size - i && memcmp(context.data + i, delim.data(), delim.size()) == 0)
+      {
+        found[k] = i;
+        missing &= ~(1u << k);
+        if (k % 2 == 0)
+        {
+          after[k / 2] = i + delim.size();
+        }
+      }
+    }
+  }
+  if (missing != 0)
+  {
+    return false;
+  }
+  phone = text_view(context.data + after[0], found[1] - after[0]);
+  position = text_view(context.data + after[1], found[3] - after[1]);
+  return true;
+}
+
+// Is a syllable position 1 or x. The position is a number or a run of x for phones outside a syllable.
+static bool is_first_position(text_view position)
+{
+  return (position.size == 1 && position.data[0] == '1') || (position.size > 0 && position.data[0] == 'x');
+}
+
+// The position from the start of a syllable at the front of a position field, e.g. 2 of 2_3
+static text_view leading_position(text_view field)
+{
+  size_t size = 0;
+  while (size < field.size && (isdigit((unsigned char)field.data[size]) || field.data[size] == 'x'))
+  {
+    size++;
+  }
+  return text_view(field.data, size);
+}
+
+// The position from the end of a syllable at the back of a position field, e.g. 3 of 2_3
+static text_view trailing_position(text_view field)
+{
+  size_t size = 0;
+  while (size < field.size && (isdigit((unsigned char)field.data[field.size - size - 1]) || field.data[field.size - size - 1] == 'x'))
+  {
+    size++;
+  }
+  return text_view(field.data + field.size - size, size);
+}
+
+// Parse a list of hts full-context phone labels and add syllables to an utt
+void parse_hts_lab(typename utterance::utterance &utt, text_view text, const hts_delimiters &delims)
+{
+  if (delims.delims.size() != 4)
+  {
+    throw std::invalid_argument("Wrong number of delimiters for parse_hts_lab. Exiting.");
+  }
   
-  // For string splitting
-  std::vector<std::string> tmp_vec;
-  
-  // For storing tmp syll info
-  float syll_start;
-  float syll_end;
+  // Times are kept in HTS units until a syllable is made
+  int64_t syll_start = 0;
+  // Phones are only in a syllable between its start and end
+  bool in_syll = false;
+  const char *file_start = text.data;
+  // The identities of the phones of the syllable so far. It only allocates when it grows.
   std::string syll_id;
   
-  std::string phone_id;
-  std::string phone_pos_beg;
-  std::string phone_pos_end;
-  int phone_start;
-  int phone_end;
-  
+  text_view fields[3];
+  text_view phone_id;
+  text_view phone_pos;
   
   // Go through each line and get the relevant details for each phone
-  for (int i = 0; i < line_list.size(); i++)
+  text_view line;
+  for (int i = 0; next_line(text, line); i++)
   {
-    // Split it in times and context
-    tmp_vec = split_string(line_list[i]);
-    // Just a silly check to make sure we're not trying something weird... which we are. this also gets rid of empty lines.
-    if (tmp_vec.size() != 3)
+    // Split it in times and context. Anything else, e.g. an empty line, is skipped.
+    text_view rest = line;
+    text_view extra;
+    if (!next_field(rest, fields[0]) || !next_field(rest, fields[1]) || !next_field(rest, fields[2]) || next_field(rest, extra))
     {
       continue;
     }
-    // Get phone start and end numbers
-    phone_start = std::atoi(tmp_vec[0].c_str());
-    phone_end = std::atoi(tmp_vec[1].c_str());
-    // Get the phone id
-    std::string tmp_str = tmp_vec[2];
-    int start = tmp_str.find(delims[0]);
-    int end = tmp_str.find(delims[1]);
-    phone_id = tmp_str.substr(start+delims[1].size(), end-start-1);
-    // Get the syllable numbers
-    start = tmp_str.find(delims[2]);
-    end = tmp_str.find(delims[3]);
-    tmp_str = tmp_str.substr(start+delims[1].size(), end-start-1);
-    phone_pos_beg = tmp_str.substr(0, 1);
-    // We need the size thing here because of the 'xx' for silences
-    phone_pos_end = tmp_str.substr(tmp_str.size()-1, 1);
-    // Make a syllable
-    // If we're at the beginning of one
-    if (phone_pos_beg == "1" || phone_pos_beg == "x")
-    {
-      syll_start = (float)phone_start/10000000.0;
-      syll_id = "";
-    }
-    syll_id += phone_id;
+    if (!find_hts_fields(fields[2], delims, phone_id, phone_pos))
+    {
+      throw std::invalid_argument("Line "+std::to_string(i+1)+" in "+utt.name+" does not hold the hts delimiters \""+delims.delims[0]+" "+delims.delims[1]+" "+delims.delims[2]+" "+delims.delims[3]+"\".");
+    }
+    // If we're at the beginning of a syllable
+    if (is_first_position(leading_position(phone_pos)))
+    {
+      syll_start = view_to_int64(fields[0]);
+      syll_id.clear();
+      in_syll = true;
+    }
+    syll_id.append(phone_id.data, phone_id.size);
+    lab_phone phone = {(size_t)(fields[2].data + fields[2].size - file_start), in_syll ? utt.sylls.size() : NO_SYLL};
+    utt.phones.push_back(phone);
     // If we're at the end of one
-    if (phone_pos_end == "1" || phone_pos_end == "x")
+    if (is_first_position(trailing_position(phone_pos)))
     {
-      syll_end = (float)phone_end/10000000.0;
-      typename syllable::syllable syll = *new typename syllable::syllable(syll_start, syll_end, syll_id);
-      utt.sylls.push_back(syll);
+      int64_t syll_end = view_to_int64(fields[1]);
+      utt.sylls.emplace_back(syll_start / HTS_TIME_UNITS, syll_end / HTS_TIME_UNITS, syll_id);
+      in_syll = false;
     }
   }
+  
+  // The phones of a syllable that never ended are in none
+  for (size_t i = utt.phones.size(); i > 0 && utt.phones[i - 1].syll == utt.sylls.size(); i--)
+  {
+    utt.phones[i - 1].syll = NO_SYLL;
+  }
 }
 
 // Parse a simple space-delimited label list and add segments to an utterance
 // Format for each line is:
 // start_time_in_seconds end_time_in_seconds segment_name
-void parse_simple_lab(typename utterance::utterance &utt, std::vector<std::string> &line_list)
+void parse_simple_lab(typename utterance::utterance &utt, text_view text)
 {
   // For string splitting
-  std::vector<std::string> tmp_vec;
+  std::vector<text_view> tmp_vec;
   
   // For storing tmp segment info
   float segment_start;
   float segment_end;
   
   // Go through each line and get the relevant details for each phone
-  for (int i = 0; i < line_list.size(); i++)
+  text_view line;
+  for (int i = 0; next_line(text, line); i++)
   {
     // Split it in times and context
-    tmp_vec = split_string(line_list[i], ' ');
+    split_view(line, tmp_vec, ' ');
     // Just a check to make sure we have the correct number of items.
     if (tmp_vec.size() != 3)
     {
       // We don't want to make a fuss if it is just an empty line.
-      if (line_list[i] == "")
+      if (line.empty())
       {
         continue;
       }
       else
       {
-        std::cout << "WARNING! Line " << i+1 << " in " << utt.name << " is malformed. Skipping..." << std::endl;
+        std::cerr << "WARNING! Line " << i+1 << " in " << utt.name << " is malformed. Skipping..." << std::endl;
         continue;
       }
     }
     // Get phone start and end time
-    segment_start = std::atof(tmp_vec[0].c_str());
-    segment_end = std::atof(tmp_vec[1].c_str());
-    typename syllable::syllable syll = *new typename syllable::syllable(segment_start, segment_end, tmp_vec[2]);
-    utt.sylls.push_back(syll);
+    segment_start = view_to_float(tmp_vec[0]);
+    segment_end = view_to_float(tmp_vec[1]);
+    utt.sylls.push_back(typename syllable::syllable(segment_start, segment_end, tmp_vec[2].str()));
   }
 }
 
@@ -230,34 +565,317 @@ void parse_simple_lab(typename utterance::utterance &utt, std::vector<std::strin
 // Write out a file for each utterance with stylisations of each syllable line by line
 void write_utts_to_file(std::vector<typename utterance::utterance> &utts,  std::string &out_path, Style_Alg &algorithm)
 {
-  for (int i; i < utts.size(); i++)
+  for (int i = 0; i < utts.size(); i++)
   {
     write_utt_to_file(utts[i], out_path, algorithm);
   }
 }
 
+// Buffer for write_utt_to_file(). It keeps its capacity so formatting does not allocate for every utterance.
+static thread_local std::string utt_buffer;
+
 // Write out a file for a utterance with stylisations of each syllable line by line
 void write_utt_to_file(typename utterance::utterance &utt, std::string &out_path, Style_Alg &algorithm)
 {
-  std::ofstream out_file;
+  utt_buffer.clear();
+  format_utt(utt, algorithm, utt_buffer);
   // Note this won't work on windows. But I refuse to add e.g. Boost as a dependency just for safe path joining abilities.
-  out_file.open(out_path + utt.name + ".sty");
-  for (int i; i < utt.sylls.size(); i++)
-  {
-    typename syllable::syllable *tmp_syll = &utt.sylls.at(i);
-    out_file << tmp_syll->start << " ";
-    out_file << tmp_syll->end << " ";
-    out_file << tmp_syll->identity << " ";
-    out_file << tmp_syll->contour_start << " ";
-    out_file << tmp_syll->contour_direction << " ";
+  write_file(out_path + utt.name + ".sty", utt_buffer);
+}
+
+// Append a float formatted as an ostream does by default
+static void append_float(std::string &out, float value)
+{
+  char buffer[32];
+  int length = snprintf(buffer, sizeof(buffer), "%g", value);
+  out.append(buffer, length);
+}
+
+// Append a float formatted as std::to_string does
+static void append_fixed(std::string &out, float value)
+{
+  char buffer[64];
+  int length = snprintf(buffer, sizeof(buffer), "%f", value);
+  out.append(buffer, std::min(length, (int)sizeof(buffer) - 1));
+}
+
+// Append the text of a label, or the raw value for LABEL_RAW
+static void append_label(std::string &out, Contour_Label label, float raw)
+{
+  if (label == LABEL_RAW)
+  {
+    append_fixed(out, raw);
+  }
+  else
+  {
+    out += contour_label_text(label);
+  }
+}
+
+// Format the stylisation of an utterance, one syllable per line, and append it to out
+void format_utt(typename utterance::utterance &utt, Style_Alg algorithm, std::string &out)
+{
+  for (int i = 0; i < utt.sylls.size(); i++)
+  {
+    typename syllable::syllable *tmp_syll = &utt.sylls[i];
+    append_float(out, tmp_syll->start);
+    out += ' ';
+    append_float(out, tmp_syll->end);
+    out += ' ';
+    out += tmp_syll->identity;
+    out += ' ';
+    append_label(out, tmp_syll->contour_start, tmp_syll->raw_start);
+    out += ' ';
+    append_label(out, tmp_syll->contour_direction, tmp_syll->raw_direction);
+    out += ' ';
+    out += extreme_position_text(tmp_syll->contour_extreme_pos);
+    append_label(out, tmp_syll->contour_extreme, tmp_syll->raw_extreme);
     if (algorithm == RAW)
     {
-      out_file << tmp_syll->contour_extreme << " ";
-      out_file << tmp_syll->contour_extreme_pos << std::endl;
+      out += ' ';
+      if (tmp_syll->contour_extreme == LABEL_RAW)
+      {
+        append_fixed(out, tmp_syll->raw_extreme_pos);
+      }
+    }
+    out += '\n';
+  }
+}
+
+// Append the style block of a syllable, or of no syllable if syll is NULL, to a context
+static void append_style_block(std::string &out, const std::string &block, typename syllable::syllable *syll, Style_Alg algorithm)
+{
+  out += block;
+  if (syll == NULL)
+  {
+    out += algorithm == RAW ? "xx+xx+xx+xx" : "xx+xx+xx";
+    return void();
+  }
+  append_label(out, syll->contour_start, syll->raw_start);
+  out += '+';
+  append_label(out, syll->contour_direction, syll->raw_direction);
+  out += '+';
+  out += extreme_position_text(syll->contour_extreme_pos);
+  append_label(out, syll->contour_extreme, syll->raw_extreme);
+  if (algorithm == RAW)
+  {
+    out += '+';
+    if (syll->contour_extreme == LABEL_RAW)
+    {
+      append_fixed(out, syll->raw_extreme_pos);
     }
     else
     {
-      out_file << tmp_syll->contour_extreme << std::endl;
+      out += "xx";
+    }
+  }
+}
+
+// Copy an HTS label file with the style of each phone's syllable added to its context
+void format_style_lab(typename utterance::utterance &utt, Style_Alg algorithm, text_view lab, const std::string &block, std::string &out)
+{
+  out.reserve(out.size() + lab.size + utt.phones.size() * (block.size() + 32));
+  size_t copied = 0;
+  for (size_t i = 0; i < utt.phones.size(); i++)
+  {
+    lab_phone &phone = utt.phones[i];
+    if (phone.context_end < copied || phone.context_end > lab.size || (phone.syll != NO_SYLL && phone.syll >= utt.sylls.size()))
+    {
+      throw std::runtime_error("The lab file of "+utt.name+" is not the one its phones were found in");
+    }
+    out.append(lab.data + copied, phone.context_end - copied);
+    append_style_block(out, block, phone.syll == NO_SYLL ? NULL : &utt.sylls[phone.syll], algorithm);
+    copied = phone.context_end;
+  }
+  out.append(lab.data + copied, lab.size - copied);
+}
+
+// Append text as a JSON string
+static void append_json_string(std::string &out, const char *text, size_t size)
+{
+  out += '"';
+  for (size_t i = 0; i < size; i++)
+  {
+    unsigned char c = text[i];
+    if (c == '"' || c == '\\')
+    {
+      out += '\\';
+      out += c;
+    }
+    else if (c < 0x20)
+    {
+      char buffer[8];
+      snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+      out += buffer;
+    }
+    else
+    {
+      out += c;
+    }
+  }
+  out += '"';
+}
+
+// Format the stylisation of an utterance as a single line JSON record and append it to out.
+// The label fields are the text format_utt writes so both formats always agree.
+void format_utt_json(typename utterance::utterance &utt, Style_Alg algorithm, std::string &out)
+{
+  std::string field;
+  out += "{\"utt\":";
+  append_json_string(out, utt.name.data(), utt.name.size());
+  out += ",\"algorithm\":\"";
+  out += style_alg_to_string(algorithm);
+  out += "\",\"sylls\":[";
+  for (size_t i = 0; i < utt.sylls.size(); i++)
+  {
+    typename syllable::syllable *tmp_syll = &utt.sylls[i];
+    if (i > 0)
+    {
+      out += ',';
+    }
+    out += '[';
+    append_float(out, tmp_syll->start);
+    out += ',';
+    append_float(out, tmp_syll->end);
+    out += ',';
+    append_json_string(out, tmp_syll->identity.data(), tmp_syll->identity.size());
+    out += ',';
+    field.clear();
+    append_label(field, tmp_syll->contour_start, tmp_syll->raw_start);
+    append_json_string(out, field.data(), field.size());
+    out += ',';
+    field.clear();
+    append_label(field, tmp_syll->contour_direction, tmp_syll->raw_direction);
+    append_json_string(out, field.data(), field.size());
+    out += ',';
+    field = extreme_position_text(tmp_syll->contour_extreme_pos);
+    append_label(field, tmp_syll->contour_extreme, tmp_syll->raw_extreme);
+    append_json_string(out, field.data(), field.size());
+    if (algorithm == RAW)
+    {
+      field.clear();
+      if (tmp_syll->contour_extreme == LABEL_RAW)
+      {
+        append_fixed(field, tmp_syll->raw_extreme_pos);
+      }
+      out += ',';
+      append_json_string(out, field.data(), field.size());
+    }
+    out += ']';
+  }
+  out += "]}\n";
+}
+
+// Write size bytes to an open file
+void write_all(int fd, const char *data, size_t size, const std::string &name)
+{
+  size_t written = 0;
+  while (written < size)
+  {
+    ssize_t count = write(fd, data + written, size - written);
+    if (count < 0)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      throw std::runtime_error("Could not write "+name+": "+strerror(errno));
+    }
+    written += count;
+  }
+}
+
+// Write contents to a file, replacing it if it exists
+void write_file(const std::string &path, const std::string &contents)
+{
+  int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+  if (fd < 0)
+  {
+    throw std::runtime_error("Could not open "+path+" for writing: "+strerror(errno));
+  }
+  try
+  {
+    write_all(fd, contents.data(), contents.size(), path);
+  }
+  catch (const std::exception &e)
+  {
+    close(fd);
+    throw;
+  }
+  // Network filesystems may only report a failed write when the file is closed
+  if (close(fd) != 0)
+  {
+    throw std::runtime_error("Could not write "+path+": "+strerror(errno));
+  }
+}
+
+// Read an index of a file of records
+std::unordered_map<std::string, record_span> read_record_index(const std::string &path)
+{
+  mapped_file file(path);
+  text_view text = file.text();
+  std::unordered_map<std::string, record_span> index;
+  size_t pos = 0;
+  while (pos < text.size)
+  {
+    size_t end = text.find("\n", pos);
+    if (end == std::string::npos)
+    {
+      end = text.size;
+    }
+    text_view line = text.substr(pos, end - pos);
+    pos = end + 1;
+    if (line.empty())
+    {
+      continue;
+    }
+    // Names may contain spaces so the numbers are taken from the end of the line
+    std::string str = line.str();
+    size_t length_pos = str.rfind(' ');
+    size_t offset_pos = length_pos == std::string::npos || length_pos == 0 ? std::string::npos : str.rfind(' ', length_pos - 1);
+    if (offset_pos == std::string::npos)
+    {
+      throw std::invalid_argument("Malformed line in record index "+path+": "+str);
+    }
+    record_span span;
+    try
+    {
+      span.offset = std::stoull(str.substr(offset_pos + 1, length_pos - offset_pos - 1));
+      span.length = std::stoull(str.substr(length_pos + 1));
+    }
+    catch (const std::exception &e)
+    {
+      throw std::invalid_argument("Malformed line in record index "+path+": "+str);
+    }
+    index[str.substr(0, offset_pos)] = span;
+  }
+  return index;
+}
+
+// Read a single record from a file of records
+std::string read_record(const std::string &path, const record_span &span)
+{
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+  {
+    throw std::runtime_error("Could not open "+path+": "+strerror(errno));
+  }
+  std::string record(span.length, '\0');
+  size_t done = 0;
+  while (done < span.length)
+  {
+    ssize_t count = pread(fd, &record[done], span.length - done, span.offset + done);
+    if (count < 0 && errno == EINTR)
+    {
+      continue;
+    }
+    if (count <= 0)
+    {
+      close(fd);
+      throw std::runtime_error("Could not read record at "+std::to_string(span.offset)+" of "+path);
     }
+    done += count;
   }
+  close(fd);
+  return record;
 }
@@ -21,8 +21,19 @@
 #include <iostream>
 #include <stdexcept>
 #include <fstream>
+#include <algorithm>
+#include <unordered_map>
+#include <stdint.h>
+
+#include <ctype.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
 
 #include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 
 #include "utterance.h"
@@ -32,29 +43,126 @@
 // Checks if a file exists
 bool file_exists(std::string &filename);
 
-// List the contents of a directory
+// List the contents of a directory. Throws if it can not be opened.
 std::vector<std::string> list_dir(std::string dir);
 
-// Opens a file line by line. Throws if file does not exist.
-std::vector<std::string> open_file(std::string filepath);
-
-// Parse an EST style file opened line by line and add timing information
-// to sylls in an utt.
+// The regular files and sub directories in a directory
+struct dir_listing
+{
+  std::vector<std::string> files;
+  std::vector<std::string> dirs;
+};
+
+// List a directory by the entry types readdir reports so no entry needs a stat. Entries are only
+// stat'ed on filesystems that do not report types and for symbolic links, which are followed to
+// files but not to directories. Skips hidden entries and backup files ending with '~'.
+// Throws if the directory can not be opened.
+dir_listing scan_dir(const std::string &dir);
+
+// Join a directory and a name in it, adding a '/' between them if the directory has none
+std::string join_path(const std::string &dir, const std::string &name);
+
+// A read only memory mapped file. The parsers work directly on views of the mapping
+// so lines are never copied. Throws if the file does not exist or cannot be mapped.
+// Files are expected to be read from start to end unless sequential is false.
+class mapped_file
+{
+public:
+  explicit mapped_file(const std::string &filepath, bool sequential=true);
+  ~mapped_file();
+  // A view of the whole file
+  text_view text() const;
+private:
+  // A mapping cannot be shared between two owners
+  mapped_file(const mapped_file &other);
+  mapped_file &operator=(const mapped_file &other);
+  const char *data;
+  size_t size;
+};
+
+// Parse the text of an EST style file and add timing information to sylls in an utt.
+// Both ascii and binary tracks are supported, which one is read from the header.
+// Binary tracks are byte swapped if written on a machine with a different byte order.
 // Note that sylls must already exist for this to work.
-void parse_est(typename utterance::utterance &utt, std::vector<std::string> &line_list);
-
-// Parse an HTS style label list and add sylls to an utterance
-void parse_hts_lab(typename utterance::utterance &utt, std::vector<std::string> &line_list, std::vector<std::string> &delims);
-
-// Parse a simple space-delimited label list and add sylls to an utterance
+void parse_est(typename utterance::utterance &utt, text_view text);
+
+// Find the frames [frames_begin, frames_end) of a segment from start to end seconds in a track of
+// num_frames 5ms frames, as parse_est does for each syllable. Returns false if the segment runs
+// past the end of the track and was cut short.
+bool segment_frame_range(float start, float end, size_t num_frames, size_t &frames_begin, size_t &frames_end);
+
+// The delimiters given to --hts around the phone identity and the syllable position fields in the
+// context of an HTS full-context label. They are compiled once into a table of which delimiters can
+// start with each byte so a context is searched for all four in a single pass.
+struct hts_delimiters
+{
+public:
+  hts_delimiters();
+  // Throws unless there are exactly four delimiters none of which is empty
+  explicit hts_delimiters(const std::vector<std::string> &delims);
+  // The left and right phone delimiters then the left and right syllable delimiters. Empty if not set.
+  std::vector<std::string> delims;
+  // Bit k of starts[c] is set if delimiter k starts with byte c
+  std::array<unsigned char, 256> starts;
+};
+
+// HTS label times are in units of 100ns
+const double HTS_TIME_UNITS = 10000000.0;
+
+// Parse the text of an HTS style label file and add sylls to an utterance.
+// A syllable starts at a phone with syllable position 1 or x from the start and ends at one with
+// position 1 or x from the end. Lines without three fields are skipped. Where the context of each
+// phone ends and its syllable are recorded in utt.phones.
+// Throws if a context does not hold the delimiters.
+void parse_hts_lab(typename utterance::utterance &utt, text_view text, const hts_delimiters &delims);
+
+// Parse the text of a simple space-delimited label file and add sylls to an utterance
 // Format for each line is:
 // start_time_in_seconds end_time_in_seconds segment_id
-void parse_simple_lab(typename utterance::utterance &utt, std::vector<std::string> &line_list);
+void parse_simple_lab(typename utterance::utterance &utt, text_view text);
 
 // Write out a file for each utterance with stylisations of each syllable line by line
 void write_utts_to_file(std::vector<typename utterance::utterance> &utts, std::string &out_path, Style_Alg &algorithm);
 
-// Write out a file for a utterance with stylisations of each syllable line by line
+// Write out a file for a utterance with stylisations of each syllable line by line.
+// Throws if the file can not be written.
 void write_utt_to_file(typename utterance::utterance &utts, std::string &out_path,  Style_Alg &algorithm);
 
+// Format the stylisation of an utterance as written by write_utt_to_file and append it to out
+void format_utt(typename utterance::utterance &utt, Style_Alg algorithm, std::string &out);
+
+// Format the stylisation of an utterance as a single line JSON record and append it to out.
+// Each syllable is an array of the fields of a line written by format_utt, e.g.
+// {"utt":"a0001","algorithm":"simplified","sylls":[[0.1,0.35,"syll","HIGH","UP","MEDIUM"]]}
+void format_utt_json(typename utterance::utterance &utt, Style_Alg algorithm, std::string &out);
+
+// The default start of the style block added to each context of an HTS label
+const std::string DEFAULT_LAB_BLOCK = "/K:";
+
+// Copy the HTS label file the utterance was parsed from to out with the style of each phone's syllable
+// added after its context as block followed by the fields of a line written by format_utt joined by +,
+// e.g. /K:HIGH+UP+END_HIGH. Fields with no value and those of phones in no syllable are xx. The bytes of the label are
+// copied through between the offsets found by parse_hts_lab. Throws if lab is not the file they were found in.
+void format_style_lab(typename utterance::utterance &utt, Style_Alg algorithm, text_view lab, const std::string &block, std::string &out);
+
+// Write size bytes to an open file. name is only used in errors. Throws if they can not all be written.
+void write_all(int fd, const char *data, size_t size, const std::string &name);
+
+// Write contents to a file in one go, replacing it if it exists. Throws if it can not be opened or written.
+void write_file(const std::string &path, const std::string &contents);
+
+// Where a record is in a file of records
+struct record_span
+{
+  uint64_t offset;
+  uint64_t length;
+};
+
+// Read an index of a file of records. Each line of the index is "name offset length".
+// Throws if the index can not be read or a line is malformed.
+std::unordered_map<std::string, record_span> read_record_index(const std::string &path);
+
+// Read a single record from a file of records without reading the rest of the file
+std::string read_record(const std::string &path, const record_span &span);
+
 #endif
@@ -0,0 +1,573 @@
+/* Copyright 2015 Rasmus Dall - rasmus@dall.dk
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+#include "jndslam_kernel.h"
+
+// AVX-512 comes with fused multiply-add and GCC would otherwise fuse the multiplies and adds
+// below on that path only, which would round differently from the other instruction sets.
+#pragma GCC optimize ("fp-contract=off")
+
+// Add up lanes pairwise by halving, i.e. lane i is added to lane i + lanes/2 until one is left.
+// The vector kernels reduce their registers in exactly this order.
+template <typename T>
+static T reduce_lanes(T *lanes, size_t count)
+{
+  for (size_t width = count / 2; width > 0; width /= 2)
+  {
+    for (size_t i = 0; i < width; i++)
+    {
+      lanes[i] = lanes[i] + lanes[i + width];
+    }
+  }
+  return lanes[0];
+}
+
+// The weighted sums of one point added to lane l of each sum.
+// The weight is the tricube weight function http://en.wikipedia.org/wiki/Local_regression#Weight_function
+template <typename T>
+static void add_point(T x, T y, T rw, T centre, T scale, size_t l, T *weights, T *xs, T *xs_squared, T *ys, T *xys)
+{
+  T dist = std::fabs(x - centre) * scale;
+  T tmp = 1 - dist * dist * dist;
+  T w = tmp * tmp * tmp * rw;
+  T xw = x * w;
+  weights[l] += w;
+  xs[l] += xw;
+  xs_squared[l] += x * xw;
+  ys[l] += y * w;
+  xys[l] += y * xw;
+}
+
+// Plain C++ kernel with the same lanes as the vector kernels
+template <typename T, size_t LANES>
+static void lowess_sums_scalar(const T *x, const T *y, const T *robustness_weights, size_t n, T centre, T scale, lowess_sums &sums)
+{
+  T weights[LANES] = {0}, xs[LANES] = {0}, xs_squared[LANES] = {0}, ys[LANES] = {0}, xys[LANES] = {0};
+  for (size_t k = 0; k < n; k++)
+  {
+    add_point(x[k], y[k], robustness_weights[k], centre, scale, k % LANES, weights, xs, xs_squared, ys, xys);
+  }
+  sums.weights = reduce_lanes(weights, LANES);
+  sums.x = reduce_lanes(xs, LANES);
+  sums.x_squared = reduce_lanes(xs_squared, LANES);
+  sums.y = reduce_lanes(ys, LANES);
+  sums.xy = reduce_lanes(xys, LANES);
+}
+
+static void lowess_sums_scalar_double(const double *x, const double *y, const double *robustness_weights, size_t n, double centre, double scale, lowess_sums &sums)
+{
+  lowess_sums_scalar<double, LOWESS_DOUBLE_LANES>(x, y, robustness_weights, n, centre, scale, sums);
+}
+
+static void lowess_sums_scalar_float(const float *x, const float *y, const float *robustness_weights, size_t n, float centre, float scale, lowess_sums &sums)
+{
+  lowess_sums_scalar<float, LOWESS_FLOAT_LANES>(x, y, robustness_weights, n, centre, scale, sums);
+}
+
+// Copy the last partial block of points into a full one. The padding sits at the centre with
+// a robustness weight of 0 so it has a weight of exactly 0 and adds nothing to the sums.
+template <typename T, size_t LANES>
+static void pad_tail(const T *x, const T *y, const T *robustness_weights, size_t count, T centre, T *tail_x, T *tail_y, T *tail_rw)
+{
+  for (size_t i = 0; i < LANES; i++)
+  {
+    tail_x[i] = i < count ? x[i] : centre;
+    tail_y[i] = i < count ? y[i] : 0;
+    tail_rw[i] = i < count ? robustness_weights[i] : 0;
+  }
+}
+
+#ifdef JNDSLAM_X86
+
+// SSE2, two doubles or four floats per register
+
+__attribute__((target("sse2")))
+static double sum_pd(__m128d v)
+{
+  return _mm_cvtsd_f64(v) + _mm_cvtsd_f64(_mm_unpackhi_pd(v, v));
+}
+
+__attribute__((target("sse2")))
+static float sum_ps(__m128 v)
+{
+  v = _mm_add_ps(v, _mm_movehl_ps(v, v));
+  return _mm_cvtss_f32(_mm_add_ss(v, _mm_shuffle_ps(v, v, 1)));
+}
+
+__attribute__((target("sse2")))
+static inline void add_points_sse2(__m128d x, __m128d y, __m128d rw, __m128d centre, __m128d scale, __m128d *acc)
+{
+  __m128d diff = _mm_sub_pd(x, centre);
+  __m128d dist = _mm_mul_pd(_mm_max_pd(diff, _mm_sub_pd(centre, x)), scale);
+  __m128d tmp = _mm_sub_pd(_mm_set1_pd(1.0), _mm_mul_pd(_mm_mul_pd(dist, dist), dist));
+  __m128d w = _mm_mul_pd(_mm_mul_pd(_mm_mul_pd(tmp, tmp), tmp), rw);
+  __m128d xw = _mm_mul_pd(x, w);
+  acc[0] = _mm_add_pd(acc[0], w);
+  acc[1] = _mm_add_pd(acc[1], xw);
+  acc[2] = _mm_add_pd(acc[2], _mm_mul_pd(x, xw));
+  acc[3] = _mm_add_pd(acc[3], _mm_mul_pd(y, w));
+  acc[4] = _mm_add_pd(acc[4], _mm_mul_pd(y, xw));
+}
+
+__attribute__((target("sse2")))
+static void add_block_sse2(const double *x, const double *y, const double *rw, __m128d centre, __m128d scale, __m128d acc[4][5])
+{
+  for (size_t r = 0; r < 4; r++)
+  {
+    add_points_sse2(_mm_loadu_pd(x + 2 * r), _mm_loadu_pd(y + 2 * r), _mm_loadu_pd(rw + 2 * r), centre, scale, acc[r]);
+  }
+}
+
+__attribute__((target("sse2")))
+static void lowess_sums_sse2_double(const double *x, const double *y, const double *robustness_weights, size_t n, double centre, double scale, lowess_sums &sums)
+{
+  const size_t LANES = LOWESS_DOUBLE_LANES;
+  __m128d c = _mm_set1_pd(centre);
+  __m128d s = _mm_set1_pd(scale);
+  __m128d acc[4][5];
+  for (size_t r = 0; r < 4; r++)
+  {
+    for (size_t i = 0; i < 5; i++)
+    {
+      acc[r][i] = _mm_setzero_pd();
+    }
+  }
+  size_t k = 0;
+  for (; k + LANES <= n; k += LANES)
+  {
+    add_block_sse2(x + k, y + k, robustness_weights + k, c, s, acc);
+  }
+  if (k < n)
+  {
+    double tail_x[LANES], tail_y[LANES], tail_rw[LANES];
+    pad_tail<double, LANES>(x + k, y + k, robustness_weights + k, n - k, centre, tail_x, tail_y, tail_rw);
+    add_block_sse2(tail_x, tail_y, tail_rw, c, s, acc);
+  }
+  double result[5];
+  for (size_t i = 0; i < 5; i++)
+  {
+    result[i] = sum_pd(_mm_add_pd(_mm_add_pd(acc[0][i], acc[2][i]), _mm_add_pd(acc[1][i], acc[3][i])));
+  }
+  sums.weights = result[0];
+  sums.x = result[1];
+  sums.x_squared = result[2];
+  sums.y = result[3];
+  sums.xy = result[4];
+}
+
+__attribute__((target("sse2")))
+static inline void add_points_sse2(__m128 x, __m128 y, __m128 rw, __m128 centre, __m128 scale, __m128 *acc)
+{
+  __m128 diff = _mm_sub_ps(x, centre);
+  __m128 dist = _mm_mul_ps(_mm_max_ps(diff, _mm_sub_ps(centre, x)), scale);
+  __m128 tmp = _mm_sub_ps(_mm_set1_ps(1.0f), _mm_mul_ps(_mm_mul_ps(dist, dist), dist));
+  __m128 w = _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(tmp, tmp), tmp), rw);
+  __m128 xw = _mm_mul_ps(x, w);
+  acc[0] = _mm_add_ps(acc[0], w);
+  acc[1] = _mm_add_ps(acc[1], xw);
+  acc[2] = _mm_add_ps(acc[2], _mm_mul_ps(x, xw));
+  acc[3] = _mm_add_ps(acc[3], _mm_mul_ps(y, w));
+  acc[4] = _mm_add_ps(acc[4], _mm_mul_ps(y, xw));
+}
+
+__attribute__((target("sse2")))
+static void add_block_sse2(const float *x, const float *y, const float *rw, __m128 centre, __m128 scale, __m128 acc[4][5])
+{
+  for (size_t r = 0; r < 4; r++)
+  {
+    add_points_sse2(_mm_loadu_ps(x + 4 * r), _mm_loadu_ps(y + 4 * r), _mm_loadu_ps(rw + 4 * r), centre, scale, acc[r]);
+  }
+}
+
+__attribute__((target("sse2")))
+static void lowess_sums_sse2_float(const float *x, const float *y, const float *robustness_weights, size_t n, float centre, float scale, lowess_sums &sums)
+{
+  const size_t LANES = LOWESS_FLOAT_LANES;
+  __m128 c = _mm_set1_ps(centre);
+  __m128 s = _mm_set1_ps(scale);
+  __m128 acc[4][5];
+  for (size_t r = 0; r < 4; r++)
+  {
+    for (size_t i = 0; i < 5; i++)
+    {
+      acc[r][i] = _mm_setzero_ps();
+    }
+  }
+  size_t k = 0;
+  for (; k + LANES <= n; k += LANES)
+  {
+    add_block_sse2(x + k, y + k, robustness_weights + k, c, s, acc);
+  }
+  if (k < n)
+  {
+    float tail_x[LANES], tail_y[LANES], tail_rw[LANES];
+    pad_tail<float, LANES>(x + k, y + k, robustness_weights + k, n - k, centre, tail_x, tail_y, tail_rw);
+    add_block_sse2(tail_x, tail_y, tail_rw, c, s, acc);
+  }
+  float result[5];
+  for (size_t i = 0; i < 5; i++)
+  {
+    result[i] = sum_ps(_mm_add_ps(_mm_add_ps(acc[0][i], acc[2][i]), _mm_add_ps(acc[1][i], acc[3][i])));
+  }
+  sums.weights = result[0];
+  sums.x = result[1];
+  sums.x_squared = result[2];
+  sums.y = result[3];
+  sums.xy = result[4];
+}
+
+// AVX2, four doubles or eight floats per register
+
+__attribute__((target("avx2")))
+static inline void add_points_avx2(__m256d x, __m256d y, __m256d rw, __m256d centre, __m256d scale, __m256d *acc)
+{
+  __m256d diff = _mm256_sub_pd(x, centre);
+  __m256d dist = _mm256_mul_pd(_mm256_max_pd(diff, _mm256_sub_pd(centre, x)), scale);
+  __m256d tmp = _mm256_sub_pd(_mm256_set1_pd(1.0), _mm256_mul_pd(_mm256_mul_pd(dist, dist), dist));
+  __m256d w = _mm256_mul_pd(_mm256_mul_pd(_mm256_mul_pd(tmp, tmp), tmp), rw);
+  __m256d xw = _mm256_mul_pd(x, w);
+  acc[0] = _mm256_add_pd(acc[0], w);
+  acc[1] = _mm256_add_pd(acc[1], xw);
+  acc[2] = _mm256_add_pd(acc[2], _mm256_mul_pd(x, xw));
+  acc[3] = _mm256_add_pd(acc[3], _mm256_mul_pd(y, w));
+  acc[4] = _mm256_add_pd(acc[4], _mm256_mul_pd(y, xw));
+}
+
+__attribute__((target("avx2")))
+static void add_block_avx2(const double *x, const double *y, const double *rw, __m256d centre, __m256d scale, __m256d acc[2][5])
+{
+  for (size_t r = 0; r < 2; r++)
+  {
+    add_points_avx2(_mm256_loadu_pd(x + 4 * r), _mm256_loadu_pd(y + 4 * r), _mm256_loadu_pd(rw + 4 * r), centre, scale, acc[r]);
+  }
+}
+
+__attribute__((target("avx2")))
+static void lowess_sums_avx2_double(const double *x, const double *y, const double *robustness_weights, size_t n, double centre, double scale, lowess_sums &sums)
+{
+  const size_t LANES = LOWESS_DOUBLE_LANES;
+  __m256d c = _mm256_set1_pd(centre);
+  __m256d s = _mm256_set1_pd(scale);
+  __m256d acc[2][5];
+  for (size_t r = 0; r < 2; r++)
+  {
+    for (size_t i = 0; i < 5; i++)
+    {
+      acc[r][i] = _mm256_setzero_pd();
+    }
+  }
+  size_t k = 0;
+  for (; k + LANES <= n; k += LANES)
+  {
+    add_block_avx2(x + k, y + k, robustness_weights + k, c, s, acc);
+  }
+  if (k < n)
+  {
+    double tail_x[LANES], tail_y[LANES], tail_rw[LANES];
+    pad_tail<double, LANES>(x + k, y + k, robustness_weights + k, n - k, centre, tail_x, tail_y, tail_rw);
+    add_block_avx2(tail_x, tail_y, tail_rw, c, s, acc);
+  }
+  double result[5];
+  for (size_t i = 0; i < 5; i++)
+  {
+    __m256d half = _mm256_add_pd(acc[0][i], acc[1][i]);
+    result[i] = sum_pd(_mm_add_pd(_mm256_castpd256_pd128(half), _mm256_extractf128_pd(half, 1)));
+  }
+  sums.weights = result[0];
+  sums.x = result[1];
+  sums.x_squared = result[2];
+  sums.y = result[3];
+  sums.xy = result[4];
+}
+
+__attribute__((target("avx2")))
+static inline void add_points_avx2(__m256 x, __m256 y, __m256 rw, __m256 centre, __m256 scale, __m256 *acc)
+{
+  __m256 diff = _mm256_sub_ps(x, centre);
+  __m256 dist = _mm256_mul_ps(_mm256_max_ps(diff, _mm256_sub_ps(centre, x)), scale);
+  __m256 tmp = _mm256_sub_ps(_mm256_set1_ps(1.0f), _mm256_mul_ps(_mm256_mul_ps(dist, dist), dist));
+  __m256 w = _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(tmp, tmp), tmp), rw);
+  __m256 xw = _mm256_mul_ps(x, w);
+  acc[0] = _mm256_add_ps(acc[0], w);
+  acc[1] = _mm256_add_ps(acc[1], xw);
+  acc[2] = _mm256_add_ps(acc[2], _mm256_mul_ps(x, xw));
+  acc[3] = _mm256_add_ps(acc[3], _mm256_mul_ps(y, w));
+  acc[4] = _mm256_add_ps(acc[4], _mm256_mul_ps(y, xw));
+}
+
+__attribute__((target("avx2")))
+static void add_block_avx2(const float *x, const float *y, const float *rw, __m256 centre, __m256 scale, __m256 acc[2][5])
+{
+  for (size_t r = 0; r < 2; r++)
+  {
+    add_points_avx2(_mm256_loadu_ps(x + 8 * r), _mm256_loadu_ps(y + 8 * r), _mm256_loadu_ps(rw + 8 * r), centre, scale, acc[r]);
+  }
+}
+
+__attribute__((target("avx2")))
+static void lowess_sums_avx2_float(const float *x, const float *y, const float *robustness_weights, size_t n, float centre, float scale, lowess_sums &sums)
+{
+  const size_t LANES = LOWESS_FLOAT_LANES;
+  __m256 c = _mm256_set1_ps(centre);
+  __m256 s = _mm256_set1_ps(scale);
+  __m256 acc[2][5];
+  for (size_t r = 0; r < 2; r++)
+  {
+    for (size_t i = 0; i < 5; i++)
+    {
+      acc[r][i] = _mm256_setzero_ps();
+    }
+  }
+  size_t k = 0;
+  for (; k + LANES <= n; k += LANES)
+  {
+    add_block_avx2(x + k, y + k, robustness_weights + k, c, s, acc);
+  }
+  if (k < n)
+  {
+    float tail_x[LANES], tail_y[LANES], tail_rw[LANES];
+    pad_tail<float, LANES>(x + k, y + k, robustness_weights + k, n - k, centre, tail_x, tail_y, tail_rw);
+    add_block_avx2(tail_x, tail_y, tail_rw, c, s, acc);
+  }
+  float result[5];
+  for (size_t i = 0; i < 5; i++)
+  {
+    __m256 half = _mm256_add_ps(acc[0][i], acc[1][i]);
+    result[i] = sum_ps(_mm_add_ps(_mm256_castps256_ps128(half), _mm256_extractf128_ps(half, 1)));
+  }
+  sums.weights = result[0];
+  sums.x = result[1];
+  sums.x_squared = result[2];
+  sums.y = result[3];
+  sums.xy = result[4];
+}
+
+// AVX-512, eight doubles or sixteen floats per register
+
+__attribute__((target("avx512f")))
+static inline void add_points_avx512(__m512d x, __m512d y, __m512d rw, __m512d centre, __m512d scale, __m512d *acc)
+{
+  __m512d diff = _mm512_sub_pd(x, centre);
+  __m512d dist = _mm512_mul_pd(_mm512_max_pd(diff, _mm512_sub_pd(centre, x)), scale);
+  __m512d tmp = _mm512_sub_pd(_mm512_set1_pd(1.0), _mm512_mul_pd(_mm512_mul_pd(dist, dist), dist));
+  __m512d w = _mm512_mul_pd(_mm512_mul_pd(_mm512_mul_pd(tmp, tmp), tmp), rw);
+  __m512d xw = _mm512_mul_pd(x, w);
+  acc[0] = _mm512_add_pd(acc[0], w);
+  acc[1] = _mm512_add_pd(acc[1], xw);
+  acc[2] = _mm512_add_pd(acc[2], _mm512_mul_pd(x, xw));
+  acc[3] = _mm512_add_pd(acc[3], _mm512_mul_pd(y, w));
+  acc[4] = _mm512_add_pd(acc[4], _mm512_mul_pd(y, xw));
+}
+
+__attribute__((target("avx512f")))
+static void lowess_sums_avx512_double(const double *x, const double *y, const double *robustness_weights, size_t n, double centre, double scale, lowess_sums &sums)
+{
+  const size_t LANES = LOWESS_DOUBLE_LANES;
+  __m512d c = _mm512_set1_pd(centre);
+  __m512d s = _mm512_set1_pd(scale);
+  __m512d acc[5];
+  for (size_t i = 0; i < 5; i++)
+  {
+    acc[i] = _mm512_setzero_pd();
+  }
+  size_t k = 0;
+  for (; k + LANES <= n; k += LANES)
+  {
+    add_points_avx512(_mm512_loadu_pd(x + k), _mm512_loadu_pd(y + k), _mm512_loadu_pd(robustness_weights + k), c, s, acc);
+  }
+  if (k < n)
+  {
+    double tail_x[LANES], tail_y[LANES], tail_rw[LANES];
+    pad_tail<double, LANES>(x + k, y + k, robustness_weights + k, n - k, centre, tail_x, tail_y, tail_rw);
+    add_points_avx512(_mm512_loadu_pd(tail_x), _mm512_loadu_pd(tail_y), _mm512_loadu_pd(tail_rw), c, s, acc);
+  }
+  double result[5];
+  for (size_t i = 0; i < 5; i++)
+  {
+    __m256d half = _mm256_add_pd(_mm512_castpd512_pd256(acc[i]), _mm512_extractf64x4_pd(acc[i], 1));
+    result[i] = sum_pd(_mm_add_pd(_mm256_castpd256_pd128(half), _mm256_extractf128_pd(half, 1)));
+  }
+  sums.weights = result[0];
+  sums.x = result[1];
+  sums.x_squared = result[2];
+  sums.y = result[3];
+  sums.xy = result[4];
+}
+
+__attribute__((target("avx512f")))
+static inline void add_points_avx512(__m512 x, __m512 y, __m512 rw, __m512 centre, __m512 scale, __m512 *acc)
+{
+  __m512 diff = _mm512_sub_ps(x, centre);
+  __m512 dist = _mm512_mul_ps(_mm512_max_ps(diff, _mm512_sub_ps(centre, x)), scale);
+  __m512 tmp = _mm512_sub_ps(_mm512_set1_ps(1.0f), _mm512_mul_ps(_mm512_mul_ps(dist, dist), dist));
+  __m512 w = _mm512_mul_ps(_mm512_mul_ps(_mm512_mul_ps(tmp, tmp), tmp), rw);
+  __m512 xw = _mm512_mul_ps(x, w);
+  acc[0] = _mm512_add_ps(acc[0], w);
+  acc[1] = _mm512_add_ps(acc[1], xw);
+  acc[2] = _mm512_add_ps(acc[2], _mm512_mul_ps(x, xw));
+  acc[3] = _mm512_add_ps(acc[3], _mm512_mul_ps(y, w));
+  acc[4] = _mm512_add_ps(acc[4], _mm512_mul_ps(y, xw));
+}
+
+__attribute__((target("avx512f")))
+static void lowess_sums_avx512_float(const float *x, const float *y, const float *robustness_weights, size_t n, float centre, float scale, lowess_sums &sums)
+{
+  const size_t LANES = LOWESS_FLOAT_LANES;
+  __m512 c = _mm512_set1_ps(centre);
+  __m512 s = _mm512_set1_ps(scale);
+  __m512 acc[5];
+  for (size_t i = 0; i < 5; i++)
+  {
+    acc[i] = _mm512_setzero_ps();
+  }
+  size_t k = 0;
+  for (; k + LANES <= n; k += LANES)
+  {
+    add_points_avx512(_mm512_loadu_ps(x + k), _mm512_loadu_ps(y + k), _mm512_loadu_ps(robustness_weights + k), c, s, acc);
+  }
+  if (k < n)
+  {
+    float tail_x[LANES], tail_y[LANES], tail_rw[LANES];
+    pad_tail<float, LANES>(x + k, y + k, robustness_weights + k, n - k, centre, tail_x, tail_y, tail_rw);
+    add_points_avx512(_mm512_loadu_ps(tail_x), _mm512_loadu_ps(tail_y), _mm512_loadu_ps(tail_rw), c, s, acc);
+  }
+  float result[5];
+  for (size_t i = 0; i < 5; i++)
+  {
+    // AVX-512F has no 256 bit float extract so the upper half is taken as doubles
+    __m256 upper = _mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(acc[i]), 1));
+    __m256 half = _mm256_add_ps(_mm512_castps512_ps256(acc[i]), upper);
+    result[i] = sum_ps(_mm_add_ps(_mm256_castps256_ps128(half), _mm256_extractf128_ps(half, 1)));
+  }
+  sums.weights = result[0];
+  sums.x = result[1];
+  sums.x_squared = result[2];
+  sums.y = result[3];
+  sums.xy = result[4];
+}
+
+#endif
+
+// The best instruction set this CPU supports
+Simd_Level detect_simd_level()
+{
+#ifdef JNDSLAM_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f"))
+  {
+    return SIMD_AVX512;
+  }
+  if (__builtin_cpu_supports("avx2"))
+  {
+    return SIMD_AVX2;
+  }
+  if (__builtin_cpu_supports("sse2"))
+  {
+    return SIMD_SSE2;
+  }
+#endif
+  return SIMD_SCALAR;
+}
+
+// The instruction set to use for a request
+Simd_Level resolve_simd_level(Simd_Level requested)
+{
+  // The CPU does not change during a run so it is only asked once
+  static const Simd_Level supported = detect_simd_level();
+  if (requested == SIMD_AUTO || requested > supported)
+  {
+    return supported;
+  }
+  return requested;
+}
+
+// Get the double precision kernel for an instruction set
+lowess_kernel select_lowess_kernel(Simd_Level level)
+{
+  switch (resolve_simd_level(level))
+  {
+#ifdef JNDSLAM_X86
+    case SIMD_AVX512:
+      return lowess_sums_avx512_double;
+    case SIMD_AVX2:
+      return lowess_sums_avx2_double;
+    case SIMD_SSE2:
+      return lowess_sums_sse2_double;
+#endif
+    default:
+      return lowess_sums_scalar_double;
+  }
+}
+
+// Get the single precision kernel for an instruction set
+lowess_kernel_float select_lowess_kernel_float(Simd_Level level)
+{
+  switch (resolve_simd_level(level))
+  {
+#ifdef JNDSLAM_X86
+    case SIMD_AVX512:
+      return lowess_sums_avx512_float;
+    case SIMD_AVX2:
+      return lowess_sums_avx2_float;
+    case SIMD_SSE2:
+      return lowess_sums_sse2_float;
+#endif
+    default:
+      return lowess_sums_scalar_float;
+  }
+}
+
+// Convert an instruction set name to a level
+Simd_Level simd_level_from_string(const std::string &name)
+{
+  if (name == "auto")
+  {
+    return SIMD_AUTO;
+  }
+  else if (name == "scalar")
+  {
+    return SIMD_SCALAR;
+  }
+  else if (name == "sse2")
+  {
+    return SIMD_SSE2;
+  }
+  else if (name == "avx2")
+  {
+    return SIMD_AVX2;
+  }
+  else if (name == "avx512")
+  {
+    return SIMD_AVX512;
+  }
+  throw std::invalid_argument("Unknown instruction set "+name);
+}
+
+// Convert a level to its instruction set name
+std::string simd_level_to_string(Simd_Level level)
+{
+  switch (level)
+  {
+    case SIMD_SCALAR:
+      return "scalar";
+    case SIMD_SSE2:
+      return "sse2";
+    case SIMD_AVX2:
+      return "avx2";
+    case SIMD_AVX512:
+      return "avx512";
+    default:
+      return "auto";
+  }
+}
@@ -0,0 +1,69 @@
+/* Copyright 2015 Rasmus Dall - rasmus@dall.dk
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+#ifndef JNDSLAM_KERNEL_H
+#define JNDSLAM_KERNEL_H
+
+#include <string>
+#include <cstddef>
+#include <cmath>
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define JNDSLAM_X86 1
+#include <immintrin.h>
+#endif
+
+// The instruction sets the LOWESS kernel can use, from slowest to fastest
+enum Simd_Level {SIMD_AUTO, SIMD_SCALAR, SIMD_SSE2, SIMD_AVX2, SIMD_AVX512};
+
+// The weighted sums of a local linear regression
+struct lowess_sums
+{
+  double weights;
+  double x;
+  double x_squared;
+  double y;
+  double xy;
+};
+
+// Compute the weighted sums over n points for a local regression centred on centre.
+// Each point is weighted by tricube(|x - centre| * scale) times its robustness weight.
+// All points must be within 1/scale of centre.
+typedef void (*lowess_kernel)(const double *x, const double *y, const double *robustness_weights, size_t n, double centre, double scale, lowess_sums &sums);
+
+// The same in single precision. x should be centred on the segment so precision is not lost on large times.
+typedef void (*lowess_kernel_float)(const float *x, const float *y, const float *robustness_weights, size_t n, float centre, float scale, lowess_sums &sums);
+
+// Sums are accumulated in this many interleaved lanes and then added pairwise in a fixed order.
+// Every instruction set follows the same order so the result does not depend on the machine.
+const size_t LOWESS_DOUBLE_LANES = 8;
+const size_t LOWESS_FLOAT_LANES = 16;
+
+// The best instruction set this CPU supports
+Simd_Level detect_simd_level();
+
+// The instruction set to use for a request. SIMD_AUTO gives the best supported one and
+// a level the CPU does not support is lowered to one it does.
+Simd_Level resolve_simd_level(Simd_Level requested);
+
+// Get the kernel for an instruction set
+lowess_kernel select_lowess_kernel(Simd_Level level);
+lowess_kernel_float select_lowess_kernel_float(Simd_Level level);
+
+// Convert between instruction set names and levels. Throws on an unknown name.
+Simd_Level simd_level_from_string(const std::string &name);
+std::string simd_level_to_string(Simd_Level level);
+
+#endif
@@ -17,36 +17,72 @@
 void usage()
 {
   std::cout << "Usage:" << std::endl;
-  std::cout << "-a/--algorithm [alg]\tSpecify stylisation algorithm. Options: simplified, jndslam, slam, raw. Default: simplified." << std::endl;
+  std::cout << "-a/--algorithm [alg]\tSpecify stylisation algorithm. Options: simplified, jndslam, slam, raw, a comma separated list of these or all. Input is parsed and smoothed once for all of them and with more than one each is written to a sub directory of the output dir named after it. Default: simplified." << std::endl;
   std::cout << "-s/--nosmooth\tDo not smooth input f0 values." << std::endl;
   std::cout << "-H/--hts [delims]\tUse HTS style input. Required argument is four strings separated by whitespace for left/right phone delimiter and left/right syllable context delimiters. E.g. \"leftphone rightphone leftsyll rightsyll\"" << std::endl;
-  std::cout << "-l/--labdir [path]\tSpecify a custom .lab location. Default: data/simple_lab/ NOTE! Dirs are not checked for correctness! This is not safe currently be careful!" << std::endl;
-  std::cout << "-p/--pitchdir [path]\tSpecify a custom .f0 location. Default: data/pitch/ NOTE! Dirs are not checked for correctness! This is not safe currently be careful!" << std::endl;
-  std::cout << "-o/--outdir [path]\tSpecify a custom output location. Default: data/out/ NOTE! Dirs are not checked for correctness! This is not safe currently be careful!" << std::endl;
+  std::cout << "-l/--labdir [path]\tSpecify a custom .lab location. Sub directories are searched too. Default: data/simple_lab/" << std::endl;
+  std::cout << "-p/--pitchdir [path]\tSpecify a custom .f0 location. Sub directories are searched too and .f0 files are matched to .lab files by name wherever they are. Default: data/pitch/" << std::endl;
+  std::cout << "-m/--manifest [file]\tRead the utterances to process from a file instead of scanning the lab and pitch dirs. Each line is \"id lab_path f0_path [speaker]\". Default: none." << std::endl;
+  std::cout << "--utts [file]\tOnly process the utterances listed in this file, one id per line. Default: all." << std::endl;
+  std::cout << "-o/--outdir [path]\tSpecify a custom output location. - writes JSON records to stdout. Default: data/out/ NOTE! Dirs are not checked for correctness! This is not safe currently be careful!" << std::endl;
+  std::cout << "--format [format]\tOutput format. text writes a .sty file per utterance, binary writes all utterances of each algorithm to one memory mappable stylisation.styb file and ndjson writes them as one JSON record per line to stylisation.ndjson with an index of where each record starts in stylisation.ndjson.idx and lab writes a copy of each HTS label file with the style of each phone's syllable added to its context. Options: text, binary, ndjson, lab. Default: text." << std::endl;
+  std::cout << "--lab-block [text]\tWith --format lab the style is added after each context as this followed by the start, direction and extreme labels joined by +. Default: /K:" << std::endl;
+  std::cout << "--index [path]\tWhen writing to stdout also write an index of where each record starts to this file. Default: none." << std::endl;
+  std::cout << "--speaker-pattern [regex]\tFind the speaker of each utterance from its name. The speaker is what the first group of the pattern matches, or the whole match if it has none. Each speaker is stylised relative to their own mean pitch. Default: the speaker column of the manifest, otherwise one speaker." << std::endl;
+  std::cout << "--save-stats [file]\tSave the mean pitch of each speaker to this file. Default: none." << std::endl;
+  std::cout << "--load-stats [file]\tTake the mean pitch of each speaker from a file saved with --save-stats instead of from the utterances processed. Default: none." << std::endl;
+  std::cout << "--serve [socket]\tStay resident and stylise one utterance per request received on this Unix domain socket, or on stdin with replies on stdout if -. Requires --load-stats. See src/jndslam_server.h for the protocol. Default: off." << std::endl;
+  std::cout << "--cache [dir]\tKeep parsed and smoothed utterances in this dir and reuse them when the input files and smoothing settings are unchanged. Default: none." << std::endl;
+  std::cout << "-j/--threads [n]\tNumber of utterances to process in parallel. 0 uses all available cores. Default: 1." << std::endl;
+  std::cout << "-S/--stream\tKeep only a small window of utterances in memory at a time. Makes an extra pass over the input to find the speaker mean. Default: off." << std::endl;
+  std::cout << "--span [fraction]\tFraction of a segment's voiced frames used for each local fit when smoothing. Must be between 0 and 1. Default: 0.2." << std::endl;
+  std::cout << "--delta [seconds]\tOnly fit smoothed values at frames more than this far apart and interpolate the rest. 0 fits every frame. Default: 0." << std::endl;
+  std::cout << "--smooth-scope [scope]\tSmooth each segment on its own or the whole utterance at once. Options: segment, utterance. Default: segment." << std::endl;
+  std::cout << "--robust-tol [weight]\tStop the robustness iterations of smoothing once no weight changes by more than this. 0 always does all 3. Default: 0.001." << std::endl;
+  std::cout << "--smooth-stats\tReport how many fits smoothing did on stderr. With --delta also report the largest difference from fitting every frame." << std::endl;
+  std::cout << "--simd [level]\tInstruction set used for smoothing. Options: auto, scalar, sse2, avx2, avx512. All give the same result. Default: auto." << std::endl;
+  std::cout << "--smooth-float\tSmooth in single precision. Faster with SIMD but values may differ slightly from the default. Default: off." << std::endl;
   std::cout << "-h/--help\tPrint this message." << std::endl;
   std::exit(0);
 }
 
+// Values for long options without a short option
+enum Long_Opt {OPT_SPAN = 256, OPT_DELTA, OPT_SMOOTH_STATS, OPT_SIMD, OPT_SMOOTH_FLOAT, OPT_ROBUST_TOL, OPT_SMOOTH_SCOPE, OPT_FORMAT, OPT_INDEX, OPT_UTTS, OPT_CACHE, OPT_SPEAKER_PATTERN, OPT_SAVE_STATS, OPT_LOAD_STATS, OPT_SERVE, OPT_LAB_BLOCK};
+
+// Parse a floating point option value or exit with usage()
+static double parse_double_opt(const char *name, const char *value)
+{
+  try
+  {
+    return std::stod(std::string(value));
+  }
+  catch (const std::exception &e)
+  {
+    std::cout << "Invalid " << name << " - " << value << ". Must be a number." << std::endl;
+    usage();
+  }
+  return 0;
+}
+
 int main(int argc, char *argv[])
 {
   // Global argument container
-  struct global_args_t {
-    bool smoothing;              // Are we smoothing?
-    Style_Alg algorithm;              // Stylisation algorithm to use
-    std::vector<std::string> hts_delims;        // What type of input are we receiving?
-    std::string lab_type;        // What type of input are we receiving?
-    std::string lab_path;        // Where can we find the .lab files?
-    std::string pitch_path;      // Where can we find the .f0 files?
-    std::string out_path;      // Where shall we put the output files?
-  } global_args;
+  global_args_t global_args;
   
   // Initialise global args to defaults
-  global_args.algorithm = SIMPLIFIED;
+  global_args.algorithms.push_back(SIMPLIFIED);
   global_args.smoothing = true;
   global_args.lab_type = "simple";
   global_args.lab_path = "data/simple_lab/";
   global_args.pitch_path = "data/pitch/";
   global_args.out_path = "data/out/";
+  global_args.format = FORMAT_TEXT;
+  global_args.lab_block = DEFAULT_LAB_BLOCK;
+  global_args.threads = 1;
+  global_args.streaming = false;
+  global_args.smooth_stats = false;
+  // Socket to serve requests on, empty to process a corpus
+  std::string serve_path;
   
   // Long options
   static const struct option long_opts[] = {
@@ -55,12 +91,31 @@ int main(int argc, char *argv[])
     { "hts", required_argument, NULL, 'H' }, //Use hts labs as input
     { "labdir", required_argument, NULL, 'l' }, // New lab dir
     { "pitchdir", required_argument, NULL, 'p' }, // New pitch dir
+    { "manifest", required_argument, NULL, 'm' }, // List of input files
+    { "utts", required_argument, NULL, OPT_UTTS }, // Subset of utterances to process
     { "outdir", required_argument, NULL, 'o' }, // New out dir
+    { "format", required_argument, NULL, OPT_FORMAT }, // Output format
+    { "index", required_argument, NULL, OPT_INDEX }, // Index of records written to stdout
+    { "lab-block", required_argument, NULL, OPT_LAB_BLOCK }, // Start of the style block of HTS labels written out
+    { "speaker-pattern", required_argument, NULL, OPT_SPEAKER_PATTERN }, // Speaker in utterance names
+    { "save-stats", required_argument, NULL, OPT_SAVE_STATS }, // Save speaker reference pitch
+    { "load-stats", required_argument, NULL, OPT_LOAD_STATS }, // Load speaker reference pitch
+    { "serve", required_argument, NULL, OPT_SERVE }, // Serve requests on a socket or stdin
+    { "cache", required_argument, NULL, OPT_CACHE }, // Cache of smoothed utterances
+    { "threads", required_argument, NULL, 'j' }, // Number of worker threads
+    { "stream", no_argument, NULL, 'S' }, // Process a window of utterances at a time
+    { "span", required_argument, NULL, OPT_SPAN }, // Smoothing span
+    { "delta", required_argument, NULL, OPT_DELTA }, // Smoothing delta
+    { "smooth-scope", required_argument, NULL, OPT_SMOOTH_SCOPE }, // Smooth per segment or utterance
+    { "robust-tol", required_argument, NULL, OPT_ROBUST_TOL }, // Robustness weight tolerance
+    { "smooth-stats", no_argument, NULL, OPT_SMOOTH_STATS }, // Report smoothing work
+    { "simd", required_argument, NULL, OPT_SIMD }, // Instruction set for smoothing
+    { "smooth-float", no_argument, NULL, OPT_SMOOTH_FLOAT }, // Smooth in single precision
     { "help", no_argument, NULL, 'h' } // Show usage()
   };
   
   // Short options
-  static const char *opt_string = "a:sH:l:p:o:h";
+  static const char *opt_string = "a:sH:l:p:m:o:j:Sh";
   
   // Parse command line options
   int long_index = 0;
@@ -70,25 +125,33 @@ int main(int argc, char *argv[])
     switch (opt)
     {
       case 'a':
-        if (std::string(optarg) == "simplified")
-        {
-          global_args.algorithm = SIMPLIFIED;
-        }
-        else if (std::string(optarg) == "jndslam")
-        {
-          global_args.algorithm = JNDSLAM;
-        }
-        else if (std::string(optarg) == "slam")
+        global_args.algorithms.clear();
+        if (std::string(optarg) == "all")
         {
-          global_args.algorithm = SLAM;
+          global_args.algorithms = {SIMPLIFIED, JNDSLAM, SLAM, RAW};
+          break;
         }
-        else if (std::string(optarg) == "raw")
+        for (const std::string &name : split_string(std::string(optarg), ','))
         {
-          global_args.algorithm = RAW;
+          Style_Alg algorithm;
+          try
+          {
+            algorithm = style_alg_from_string(name);
+          }
+          catch (const std::exception &e)
+          {
+            std::cout << "Invalid algorithm choice - " << name << ". Must be jndslam, slam, raw or simplified, a comma separated list of these or all." << std::endl;
+            usage();
+          }
+          // Each algorithm is only run once
+          if (std::find(global_args.algorithms.begin(), global_args.algorithms.end(), algorithm) == global_args.algorithms.end())
+          {
+            global_args.algorithms.push_back(algorithm);
+          }
         }
-        else
+        if (global_args.algorithms.empty())
         {
-          std::cout << "Invalid algorithm choice - " << optarg << ". Must be jndslam, slam, raw or simplified." << std::endl;
+          std::cout << "Invalid algorithm choice - " << optarg << ". At least one algorithm must be given." << std::endl;
           usage();
         }
         break;
@@ -96,8 +159,11 @@ int main(int argc, char *argv[])
         global_args.smoothing = false;
         break;
       case 'H':
-        global_args.hts_delims = split_string(std::string(optarg));
-        if (global_args.hts_delims.size() != 4)
+        try
+        {
+          global_args.hts_delims = hts_delimiters(split_string(std::string(optarg)));
+        }
+        catch (const std::exception &e)
         {
           std::cout << "Invalid hts delimiters - " << optarg << ". Must be exactly 4 space separated strings e.g. \"leftphone rightphone leftsyll rightsyll\"." << std::endl;
           usage();
@@ -110,9 +176,134 @@ int main(int argc, char *argv[])
       case 'p':
         global_args.pitch_path = std::string(optarg);
         break;
+      case 'm':
+        global_args.manifest_path = std::string(optarg);
+        break;
+      case OPT_UTTS:
+        global_args.subset_path = std::string(optarg);
+        break;
       case 'o':
         global_args.out_path = std::string(optarg);
         break;
+      case OPT_FORMAT:
+        if (std::string(optarg) == "text")
+        {
+          global_args.format = FORMAT_TEXT;
+        }
+        else if (std::string(optarg) == "binary")
+        {
+          global_args.format = FORMAT_BINARY;
+        }
+        else if (std::string(optarg) == "ndjson")
+        {
+          global_args.format = FORMAT_NDJSON;
+        }
+        else if (std::string(optarg) == "lab")
+        {
+          global_args.format = FORMAT_LAB;
+        }
+        else
+        {
+          std::cout << "Invalid output format - " << optarg << ". Must be text, binary, ndjson or lab." << std::endl;
+          usage();
+        }
+        break;
+      case OPT_INDEX:
+        global_args.index_path = std::string(optarg);
+        break;
+      case OPT_LAB_BLOCK:
+        global_args.lab_block = std::string(optarg);
+        break;
+      case OPT_SPEAKER_PATTERN:
+        global_args.speaker_pattern = std::string(optarg);
+        break;
+      case OPT_SAVE_STATS:
+        global_args.save_stats_path = std::string(optarg);
+        break;
+      case OPT_LOAD_STATS:
+        global_args.load_stats_path = std::string(optarg);
+        break;
+      case OPT_SERVE:
+        serve_path = std::string(optarg);
+        break;
+      case OPT_CACHE:
+        global_args.cache_path = std::string(optarg);
+        break;
+      case 'j':
+        try
+        {
+          global_args.threads = std::stoul(std::string(optarg));
+        }
+        catch (const std::exception &e)
+        {
+          std::cout << "Invalid number of threads - " << optarg << ". Must be a non-negative integer." << std::endl;
+          usage();
+        }
+        break;
+      case 'S':
+        global_args.streaming = true;
+        break;
+      case OPT_SPAN:
+        global_args.smoothing_params.span = parse_double_opt("smoothing span", optarg);
+        if (global_args.smoothing_params.span < 0 || global_args.smoothing_params.span > 1)
+        {
+          std::cout << "Invalid smoothing span - " << optarg << ". Must be between 0 and 1." << std::endl;
+          usage();
+        }
+        break;
+      case OPT_DELTA:
+        global_args.smoothing_params.delta = parse_double_opt("smoothing delta", optarg);
+        if (global_args.smoothing_params.delta < 0)
+        {
+          std::cout << "Invalid smoothing delta - " << optarg << ". Must not be negative." << std::endl;
+          usage();
+        }
+        break;
+      case OPT_SMOOTH_SCOPE:
+        if (std::string(optarg) == "segment")
+        {
+          global_args.smoothing_params.scope = SCOPE_SEGMENT;
+        }
+        else if (std::string(optarg) == "utterance")
+        {
+          global_args.smoothing_params.scope = SCOPE_UTTERANCE;
+        }
+        else
+        {
+          std::cout << "Invalid smoothing scope - " << optarg << ". Must be segment or utterance." << std::endl;
+          usage();
+        }
+        break;
+      case OPT_ROBUST_TOL:
+        global_args.smoothing_params.tolerance = parse_double_opt("robustness tolerance", optarg);
+        if (global_args.smoothing_params.tolerance < 0)
+        {
+          std::cout << "Invalid robustness tolerance - " << optarg << ". Must not be negative." << std::endl;
+          usage();
+        }
+        break;
+      case OPT_SMOOTH_STATS:
+        global_args.smooth_stats = true;
+        global_args.smoothing_params.verify = true;
+        break;
+      case OPT_SIMD:
+        try
+        {
+          global_args.smoothing_params.simd = simd_level_from_string(std::string(optarg));
+        }
+        catch (const std::exception &e)
+        {
+          std::cout << "Invalid instruction set - " << optarg << ". Must be auto, scalar, sse2, avx2 or avx512." << std::endl;
+          usage();
+        }
+        if (resolve_simd_level(global_args.smoothing_params.simd) < global_args.smoothing_params.simd)
+        {
+          std::cerr << "WARNING! This CPU does not support " << optarg << ". Using " << simd_level_to_string(resolve_simd_level(global_args.smoothing_params.simd)) << " instead." << std::endl;
+        }
+        break;
+      case OPT_SMOOTH_FLOAT:
+        global_args.smoothing_params.single_precision = true;
+        break;
       case 'h':
       default:
         usage();
@@ -122,83 +313,80 @@ int main(int argc, char *argv[])
     opt = getopt_long(argc, argv, opt_string, long_opts, &long_index);
   }
   
-  // Get a list of files
-  std::vector<std::string> lab_dir = list_dir(global_args.lab_path);
-  std::vector<std::string> pitch_dir = list_dir(global_args.pitch_path);
-  
-  // Prepare list of opened files
-  std::vector<std::vector<std::string> > lab_files;
-  std::vector<std::vector<std::string> > pitch_files;
-  
-  // Ready a list of utts
-  std::vector<typename utterance::utterance> utts;
-  
-  // Match each lab file to a pitch file
-  for (int i = 0; i < lab_dir.size(); i++)
+  // Only a stream of records can go to stdout
+  if (global_args.out_path == STDOUT_PATH)
   {
-    struct stat s;
-    if (stat((global_args.lab_path+lab_dir[i]).c_str(), &s) == 0)
+    if (global_args.format == FORMAT_BINARY || global_args.format == FORMAT_LAB)
     {
-      // Is this a file?
-      if(s.st_mode & S_IFREG)
-      {
-        // Open it
-        lab_files.push_back(open_file(global_args.lab_path+lab_dir[i]));
-        // Find the basename
-        std::string basename = split_string(lab_dir[i], '.')[0];
-        // Try and open the corresponding pitch file.
-        std::string pitch_file_path = global_args.pitch_path+basename+".f0";
-        pitch_files.push_back(open_file(pitch_file_path));
-        // If we found and opened the pitch file proceed and make an utterances
-        typename utterance::utterance* utt = new typename utterance::utterance(basename);
-        utts.push_back(*utt);
-      }
+      std::cout << "Only ndjson output can be written to stdout. Use --format ndjson." << std::endl;
+      usage();
     }
+    global_args.format = FORMAT_NDJSON;
   }
   
-  // Add segment info to utterance from input lab file
-  for (int i = 0; i < utts.size(); i++)
+  // Style can only be added to HTS labels
+  if (global_args.format == FORMAT_LAB && global_args.lab_type != "hts")
   {
-    if (global_args.lab_type == "simple")
+    std::cout << "--format lab requires HTS labels given with --hts." << std::endl;
+    usage();
+  }
+  
+  // Bad input or output stops the run with a message rather than an abort
+  smooth_stats stats;
+  try
+  {
+    // Serve requests with reference pitches loaded once
+    if (!serve_path.empty())
     {
-      parse_simple_lab(utts[i], lab_files[i]);
+      if (global_args.load_stats_path.empty())
+      {
+        std::cout << "--serve requires --load-stats for the reference pitch of each speaker." << std::endl;
+        usage();
+      }
+      speaker_stats reference = load_speaker_stats(global_args.load_stats_path);
+      make_cache_dir(global_args);
+      if (serve_path == STDOUT_PATH)
+      {
+        serve_stream(STDIN_FILENO, STDOUT_FILENO, global_args, reference);
+      }
+      else
+      {
+        serve_socket(serve_path, global_args, reference);
+      }
+      return 0;
     }
-    else if (global_args.lab_type == "hts")
+    
+    // Match each lab file to a pitch file
+    std::vector<utt_job> jobs = load_jobs(global_args);
+    make_style_dirs(global_args);
+    make_cache_dir(global_args);
+    
+    // Parse, smooth, stylise and write out all utterances
+    if (global_args.streaming)
     {
-      parse_hts_lab(utts[i], lab_files[i], global_args.hts_delims);
+      stream_corpus(jobs, global_args, stats);
     }
     else
     {
-      throw std::invalid_argument("Input type is of unrecognised type "+global_args.lab_type+". Exiting.");
+      process_corpus(jobs, global_args, stats);
     }
   }
-  
-  // Add pitch information to utterance from EST file
-  for (int i = 0; i < utts.size(); i++)
+  catch (const std::exception &e)
   {
-    parse_est(utts[i], pitch_files[i]);
+    std::cerr << "ERROR! " << e.what() << std::endl;
+    return 1;
   }
   
-  // Smooth pitch for each segment if applicable
-  if (global_args.smoothing)
-  {
-    smooth_utts(utts);
-  }
-  else
+  if (global_args.smooth_stats)
   {
-    remove_unvoiced(utts);
+    std::cerr << "Smoothing kernel: " << simd_level_to_string(resolve_simd_level(global_args.smoothing_params.simd)) << (global_args.smoothing_params.single_precision ? " single" : " double") << " precision." << std::endl;
+    std::cerr << "Smoothed " << stats.segments << " segments with " << stats.fits << " fits and " << stats.interpolated << " interpolated points." << std::endl;
+    std::cerr << "Did " << stats.robustness_iterations << " robustness iterations out of at most " << stats.segments * global_args.smoothing_params.iters << "." << std::endl;
+    if (global_args.smoothing_params.delta > 0)
+    {
+      std::cerr << "Largest difference from fitting every point was " << stats.max_delta_error << " Hz." << std::endl;
+    }
   }
   
-  // Stylise syllables
-  stylise(utts, global_args.algorithm);
-  
-  // Write output stylisation
-  write_utts_to_file(utts, global_args.out_path, global_args.algorithm);
-  
-  // Add style info to HTS lab and write lab
-  // TODO
-  // add_style_to_lab()
-  // write_file()
-  
   return 0;
 }
@@ -21,6 +21,9 @@
 #include "jndslam_std.h"
 #include "jndslam_style.h"
 #include "jndslam_smooth.h"
+#include "jndslam_parallel.h"
+#include "jndslam_corpus.h"
+#include "jndslam_server.h"
 
 int main(int argc, char *argv[]);
 
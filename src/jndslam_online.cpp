@@ -0,0 +1,177 @@
+/* Copyright 2015 Rasmus Dall - rasmus@dall.dk
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+
+#include "jndslam_online.h"
+
+online_styliser::online_styliser(float mean_pitch, const stylise_options &options, size_t context_frames, size_t lookahead_frames)
+  : utt("")
+{
+  this->mean_pitch = mean_pitch;
+  this->options = options;
+  this->context_frames = context_frames;
+  this->lookahead_frames = lookahead_frames;
+  this->finished = false;
+  this->first_frame = 0;
+  this->segments_end = 0;
+  this->utt.sylls.push_back(typename syllable::syllable(0, 0, ""));
+}
+
+// Add frames to the end of the track
+void online_styliser::push_frames(const float *times, const float *voicing, const float *f0, size_t num_frames)
+{
+  if (finished)
+  {
+    throw std::invalid_argument("Can not push frames after the track is finished");
+  }
+  for (size_t i = 0; i < num_frames; i++)
+  {
+    frames.push_back(times[i], voicing[i], f0[i]);
+  }
+}
+
+// End the current segment before end_frame
+void online_styliser::end_segment(size_t end_frame)
+{
+  if (finished)
+  {
+    throw std::invalid_argument("Can not end a segment after the track is finished");
+  }
+  if (end_frame < segments_end)
+  {
+    throw std::invalid_argument("Segment end "+std::to_string(end_frame)+" is before the end of the last segment at "+std::to_string(segments_end));
+  }
+  segments.push_back(std::make_pair(segments_end, end_frame));
+  segments_end = end_frame;
+}
+
+// End the current segment at a time in seconds
+void online_styliser::end_segment_at(float end_time)
+{
+  // A segment of a lab file ends after the frame of its end time and the next one starts there
+  size_t frames_begin;
+  size_t frames_end;
+  segment_frame_range(end_time, end_time, std::numeric_limits<long>::max(), frames_begin, frames_end);
+  end_segment(std::max(frames_end, segments_end));
+}
+
+// There are no more frames
+void online_styliser::finish()
+{
+  finished = true;
+}
+
+// Stylise the next segment if it is ready
+bool online_styliser::next_style(segment_style &out)
+{
+  if (segments.empty())
+  {
+    return false;
+  }
+  size_t begin = segments.front().first;
+  size_t end = segments.front().second;
+  if (!finished && frames_pushed() < end + lookahead_frames)
+  {
+    return false;
+  }
+  stylise_segment(begin, end, out);
+  segments.pop_front();
+  
+  // Drop the frames no later segment can need
+  size_t next_begin = segments.empty() ? segments_end : segments.front().first;
+  size_t keep_from = std::min(next_begin > context_frames ? next_begin - context_frames : 0, frames_pushed());
+  if (keep_from > first_frame)
+  {
+    frames.drop_front(keep_from - first_frame);
+    first_frame = keep_from;
+  }
+  return true;
+}
+
+// Stylise frames [begin, end) with what has been pushed
+void online_styliser::stylise_segment(size_t begin, size_t end, segment_style &out)
+{
+  // Segments past the end of a finished track are cut short as with a lab file
+  end = std::min(end, frames_pushed());
+  begin = std::min(begin, end);
+  size_t window_begin = std::max(begin > context_frames ? begin - context_frames : 0, first_frame);
+  size_t window_end = std::min(end + lookahead_frames, frames_pushed());
+  pitch_span window(frames, window_begin - first_frame, window_end - first_frame);
+  
+  // The segment gets the values of its own voiced frames, which come after those of the context
+  size_t skip = 0;
+  size_t voiced = 0;
+  for (size_t i = window_begin; i < end; i++)
+  {
+    if (frames.voicing[i - first_frame] == 1)
+    {
+      if (i < begin)
+      {
+        skip++;
+      }
+      else
+      {
+        voiced++;
+      }
+    }
+  }
+  smoothed.clear();
+  if (options.smoothing)
+  {
+    smooth_params params = options.smoothing_params;
+    smooth(window, smoothed, params, smoothing_stats);
+  }
+  else
+  {
+    for (size_t i = 0; i < window.size; i++)
+    {
+      if (window.voicing[i] == 1)
+      {
+        smoothed.push_back(window.times[i], window.voicing[i], window.f0[i]);
+      }
+    }
+  }
+  
+  utt.pitch.clear();
+  for (size_t k = skip; k < skip + voiced; k++)
+  {
+    utt.pitch.push_back(smoothed.times[k], smoothed.voicing[k], smoothed.f0[k]);
+  }
+  typename syllable::syllable &syll = utt.sylls[0];
+  syll.frames_begin = begin;
+  syll.frames_end = end;
+  syll.pitch_begin = 0;
+  syll.pitch_end = utt.pitch.size();
+  find_contours(utt, mean_pitch, contours);
+  style_contours(utt, contours, options.algorithm);
+  syllable_style(syll, out);
+}
+
+// Number of frames pushed
+size_t online_styliser::frames_pushed() const
+{
+  return first_frame + frames.size();
+}
+
+// Number of frames still held
+size_t online_styliser::frames_held() const
+{
+  return frames.size();
+}
+
+// Smoothing work done so far
+const smooth_stats &online_styliser::stats() const
+{
+  return smoothing_stats;
+}
@@ -0,0 +1,83 @@
+/* Copyright 2015 Rasmus Dall - rasmus@dall.dk
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+
+#ifndef JNDSLAM_ONLINE_H
+#define JNDSLAM_ONLINE_H
+
+#include <deque>
+#include <vector>
+#include <limits>
+#include <stdexcept>
+#include <algorithm>
+
+#include "jndslam_api.h"
+
+// Stylises a pitch track while it is still being generated, e.g. during streaming synthesis.
+// Frames and segment boundaries are pushed as they become known and the style of each segment
+// can be taken as soon as its frames and lookahead_frames more have been pushed, relative to a
+// fixed reference pitch given up front.
+//
+// Each segment is smoothed together with up to context_frames frames before it and lookahead_frames
+// after it and then gets the smoothed values of its own frames. With no context and no lookahead
+// this is exactly the segment scope smoothing of stylise_segments. More of either lessens the edge
+// effects at segment boundaries, as the utterance scope does, at the cost of latency. The smoothing
+// span is a fraction of the frames of each such window.
+//
+// Only frames from context_frames before the first unstylised segment are kept so memory is bounded
+// by the longest segment plus the context and lookahead, not by the length of the track.
+class online_styliser
+{
+public:
+  online_styliser(float mean_pitch, const stylise_options &options, size_t context_frames, size_t lookahead_frames);
+  // Add frames to the end of the track. Frame i has times[i], voicing[i] (1 if voiced) and f0[i].
+  // Throws if the track is finished.
+  void push_frames(const float *times, const float *voicing, const float *f0, size_t num_frames);
+  // End the current segment before frame end_frame, counted from the start of the track.
+  // The next segment begins there. The frames need not have been pushed yet.
+  // Throws if end_frame is before the end of the last segment or the track is finished.
+  void end_segment(size_t end_frame);
+  // End the current segment at a time in seconds, mapped to frames as the segments of a lab file are
+  void end_segment_at(float end_time);
+  // There are no more frames. Every segment can then be stylised and those past the end of the track are cut short.
+  void finish();
+  // Stylise the next segment into out if it is ready. Returns false if there is none.
+  bool next_style(segment_style &out);
+  // Number of frames pushed and number still held
+  size_t frames_pushed() const;
+  size_t frames_held() const;
+  // Smoothing work done so far
+  const smooth_stats &stats() const;
+private:
+  // Stylise frames [begin, end) with what has been pushed
+  void stylise_segment(size_t begin, size_t end, segment_style &out);
+  float mean_pitch;
+  stylise_options options;
+  size_t context_frames;
+  size_t lookahead_frames;
+  bool finished;
+  // The frames held, of which the first is frame first_frame of the track
+  pitch_track frames;
+  size_t first_frame;
+  // The frame ranges of the segments ended but not yet stylised, in order
+  std::deque<std::pair<size_t, size_t> > segments;
+  size_t segments_end;
+  smooth_stats smoothing_stats;
+  // Scratch space reused for every segment
+  typename utterance::utterance utt;
+  pitch_track smoothed;
+  std::vector<contour_stats> contours;
+};
+
+#endif
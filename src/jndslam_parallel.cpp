@@ -0,0 +1,150 @@
+/* Copyright 2015 Rasmus Dall - rasmus@dall.dk
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+#include "jndslam_parallel.h"
+
+// The work queue of a single worker
+struct work_queue
+{
+  std::deque<size_t> items;
+  std::mutex lock;
+};
+
+// Resolve the number of worker threads to use
+unsigned int resolve_threads(unsigned int threads)
+{
+  if (threads == 0)
+  {
+    threads = std::thread::hardware_concurrency();
+  }
+  // hardware_concurrency() may return 0 if it cannot tell
+  if (threads == 0)
+  {
+    threads = 1;
+  }
+  return threads;
+}
+
+// Order item indices by descending cost
+std::vector<size_t> longest_first(const std::vector<size_t> &costs)
+{
+  std::vector<size_t> order(costs.size());
+  for (size_t i = 0; i < order.size(); i++)
+  {
+    order[i] = i;
+  }
+  std::stable_sort(order.begin(), order.end(), [&costs](size_t a, size_t b) { return costs[a] > costs[b]; });
+  return order;
+}
+
+// Take the next item for worker id, first from its own queue then by stealing from the others.
+// Returns false once all queues are empty.
+static bool next_item(std::vector<work_queue> &queues, size_t id, size_t &item)
+{
+  {
+    std::lock_guard<std::mutex> guard(queues[id].lock);
+    if (!queues[id].items.empty())
+    {
+      item = queues[id].items.front();
+      queues[id].items.pop_front();
+      return true;
+    }
+  }
+  for (size_t i = 1; i < queues.size(); i++)
+  {
+    work_queue &victim = queues[(id + i) % queues.size()];
+    std::lock_guard<std::mutex> guard(victim.lock);
+    if (!victim.items.empty())
+    {
+      item = victim.items.back();
+      victim.items.pop_back();
+      return true;
+    }
+  }
+  return false;
+}
+
+// Run func on every item using a pool of work-stealing threads
+void parallel_for(const std::vector<size_t> &order, unsigned int threads, const std::function<void(size_t)> &func)
+{
+  if (threads > order.size())
+  {
+    threads = order.size();
+  }
+  // No need for any threads
+  if (threads <= 1)
+  {
+    for (size_t i = 0; i < order.size(); i++)
+    {
+      func(order[i]);
+    }
+    return void();
+  }
+
+  // Deal the items round robin so each worker starts on one of the longest
+  std::vector<work_queue> queues(threads);
+  for (size_t i = 0; i < order.size(); i++)
+  {
+    queues[i % threads].items.push_back(order[i]);
+  }
+
+  std::exception_ptr error;
+  std::mutex error_lock;
+
+  auto worker = [&](size_t id)
+  {
+    size_t item;
+    while (next_item(queues, id, item))
+    {
+      try
+      {
+        func(item);
+      }
+      catch (...)
+      {
+        std::lock_guard<std::mutex> guard(error_lock);
+        if (!error)
+        {
+          error = std::current_exception();
+        }
+        // Drain our own queue, the others will stop when they run dry
+        std::lock_guard<std::mutex> queue_guard(queues[id].lock);
+        queues[id].items.clear();
+      }
+      // Stop early if anyone failed
+      std::lock_guard<std::mutex> guard(error_lock);
+      if (error)
+      {
+        return void();
+      }
+    }
+  };
+
+  // The calling thread works as well
+  std::vector<std::thread> pool;
+  for (size_t i = 1; i < threads; i++)
+  {
+    pool.push_back(std::thread(worker, i));
+  }
+  worker(0);
+  for (size_t i = 0; i < pool.size(); i++)
+  {
+    pool[i].join();
+  }
+
+  if (error)
+  {
+    std::rethrow_exception(error);
+  }
+}
@@ -0,0 +1,40 @@
+/* Copyright 2015 Rasmus Dall - rasmus@dall.dk
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+#ifndef JNDSLAM_PARALLEL_H
+#define JNDSLAM_PARALLEL_H
+
+#include <vector>
+#include <deque>
+#include <functional>
+#include <algorithm>
+#include <exception>
+#include <thread>
+#include <mutex>
+
+// Resolve the number of worker threads to use. 0 means one per available core.
+unsigned int resolve_threads(unsigned int threads);
+
+// Order item indices by descending cost so the longest items are started first
+// and do not end up as stragglers at the end of a run. Ties keep their original order.
+std::vector<size_t> longest_first(const std::vector<size_t> &costs);
+
+// Run func once for every item index in order using a pool of work-stealing threads.
+// Items are dealt round robin to the workers. Each worker takes from the front of its own queue
+// and when that is empty steals from the back of the other queues.
+// With a single thread everything is run on the calling thread in the given order.
+// If func throws the remaining items are abandoned and the first exception is rethrown once all workers have stopped.
+void parallel_for(const std::vector<size_t> &order, unsigned int threads, const std::function<void(size_t)> &func);
+
+#endif
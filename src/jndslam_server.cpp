@@ -0,0 +1,245 @@
+/* Copyright 2015 Rasmus Dall - rasmus@dall.dk
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+
+#include "jndslam_server.h"
+
+// Reads requests from a file descriptor a block at a time
+class request_reader
+{
+public:
+  explicit request_reader(int fd) : fd(fd), pos(0) {}
+  // Read up to the next newline. Returns false at the end of input.
+  bool read_line(std::string &line);
+  // Read exactly size bytes. Returns false if input ends first.
+  bool read_bytes(size_t size, std::string &out);
+private:
+  // Read more input onto the buffer. Returns false at the end of input.
+  bool fill();
+  int fd;
+  std::string buffer;
+  size_t pos;
+};
+
+// Read more input onto the buffer
+bool request_reader::fill()
+{
+  // Drop what has been consumed so the buffer does not grow with the session
+  if (pos > 0)
+  {
+    buffer.erase(0, pos);
+    pos = 0;
+  }
+  char block[65536];
+  while (true)
+  {
+    ssize_t count = read(fd, block, sizeof(block));
+    if (count < 0 && errno == EINTR)
+    {
+      continue;
+    }
+    if (count <= 0)
+    {
+      return false;
+    }
+    buffer.append(block, count);
+    return true;
+  }
+}
+
+// Read up to the next newline
+bool request_reader::read_line(std::string &line)
+{
+  size_t newline;
+  while ((newline = buffer.find('\n', pos)) == std::string::npos)
+  {
+    if (!fill())
+    {
+      return false;
+    }
+  }
+  line.assign(buffer, pos, newline - pos);
+  pos = newline + 1;
+  return true;
+}
+
+// Read exactly size bytes
+bool request_reader::read_bytes(size_t size, std::string &out)
+{
+  while (buffer.size() - pos < size)
+  {
+    if (!fill())
+    {
+      return false;
+    }
+  }
+  out.assign(buffer, pos, size);
+  pos += size;
+  return true;
+}
+
+// Parse a byte count of a request
+static size_t parse_size(text_view field)
+{
+  try
+  {
+    return std::stoul(field.str());
+  }
+  catch (const std::exception &e)
+  {
+    throw std::invalid_argument("Invalid size "+field.str());
+  }
+}
+
+// Parse, smooth and stylise the utterance of one request and format the reply into reply.
+// Returns false if no more requests can be read, either as the input ended in the middle of the
+// request or as its data had a size that could not be read so the next request can not be found.
+static bool serve_request(request_reader &reader, const std::string &request, global_args_t &args, const speaker_stats &reference, std::string &reply)
+{
+  std::vector<text_view> fields;
+  split_view(text_view(request), fields, ' ');
+  std::string id = fields.size() > 1 ? fields[1].str() : std::string();
+  bool in_sync = true;
+  try
+  {
+    if (fields.size() < 4 || fields.size() > 5 || !(fields[0] == "FILE" || fields[0] == "INLINE"))
+    {
+      throw std::invalid_argument("Malformed request");
+    }
+    typename utterance::utterance utt(id);
+    std::string speaker = fields.size() == 5 ? fields[4].str() : std::string();
+    smooth_stats stats;
+    if (fields[0] == "FILE")
+    {
+      utt_job job;
+      job.name = id;
+      job.lab_path = fields[2].str();
+      job.pitch_path = fields[3].str();
+      job.speaker = speaker;
+      job.cost = 0;
+      load_utt(utt, job, args, stats);
+    }
+    else
+    {
+      // The data is read before anything else can fail so the next request is found whatever happens
+      std::string lab;
+      std::string pitch;
+      in_sync = false;
+      size_t lab_size = parse_size(fields[2]);
+      size_t pitch_size = parse_size(fields[3]);
+      if (!reader.read_bytes(lab_size, lab) || !reader.read_bytes(pitch_size, pitch))
+      {
+        return false;
+      }
+      in_sync = true;
+      parse_utt(utt, text_view(lab), text_view(pitch), args, stats);
+    }
+    float mean_pitch = speaker_mean_pitch(reference, speaker);
+    
+    std::vector<contour_stats> contours;
+    find_contours(utt, mean_pitch, contours);
+    std::string body;
+    for (size_t a = 0; a < args.algorithms.size(); a++)
+    {
+      style_contours(utt, contours, args.algorithms[a]);
+      body.clear();
+      format_utt(utt, args.algorithms[a], body);
+      reply += "OK "+id+" "+style_alg_to_string(args.algorithms[a])+" "+std::to_string(body.size())+"\n";
+      reply += body;
+    }
+  }
+  catch (const std::exception &e)
+  {
+    std::string message = e.what();
+    std::replace(message.begin(), message.end(), '\n', ' ');
+    reply = "ERROR "+id+" "+message+"\n";
+  }
+  return in_sync;
+}
+
+// Serve requests read from in_fd and reply on out_fd until in_fd ends
+void serve_stream(int in_fd, int out_fd, global_args_t &args, const speaker_stats &reference)
+{
+  request_reader reader(in_fd);
+  std::string request;
+  std::string reply;
+  while (reader.read_line(request))
+  {
+    if (request.empty())
+    {
+      continue;
+    }
+    reply.clear();
+    bool in_sync = serve_request(reader, request, args, reference, reply);
+    write_all(out_fd, reply.data(), reply.size(), "reply");
+    if (!in_sync)
+    {
+      break;
+    }
+  }
+}
+
+// Listen on a Unix domain socket and serve each connection on its own thread
+void serve_socket(const std::string &path, global_args_t &args, const speaker_stats &reference)
+{
+  struct sockaddr_un address;
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  if (path.size() >= sizeof(address.sun_path))
+  {
+    throw std::invalid_argument("Socket path is too long: "+path);
+  }
+  memcpy(address.sun_path, path.c_str(), path.size());
+  
+  int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listener < 0)
+  {
+    throw std::runtime_error("Could not create socket: "+std::string(strerror(errno)));
+  }
+  // A socket left behind by an earlier server is replaced
+  unlink(path.c_str());
+  if (bind(listener, (struct sockaddr *)&address, sizeof(address)) != 0 || listen(listener, SOMAXCONN) != 0)
+  {
+    int error = errno;
+    close(listener);
+    throw std::runtime_error("Could not listen on "+path+": "+strerror(error));
+  }
+  // A client that goes away must not take the server with it
+  signal(SIGPIPE, SIG_IGN);
+  
+  while (true)
+  {
+    int connection = accept(listener, NULL, NULL);
+    if (connection < 0)
+    {
+      if (errno != EINTR && errno != ECONNABORTED)
+      {
+        std::cerr << "WARNING! Could not accept connection: " << strerror(errno) << std::endl;
+      }
+      continue;
+    }
+    std::thread([connection, &args, &reference]()
+    {
+      try
+      {
+        serve_stream(connection, connection, args, reference);
+      }
+      catch (const std::exception &e)
+      {
+        std::cerr << "WARNING! Connection ended: " << e.what() << std::endl;
+      }
+      close(connection);
+    }).detach();
+  }
+}
@@ -0,0 +1,58 @@
+/* Copyright 2015 Rasmus Dall - rasmus@dall.dk
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+
+#ifndef JNDSLAM_SERVER_H
+#define JNDSLAM_SERVER_H
+
+#include <string>
+#include <vector>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+
+#include <errno.h>
+#include <signal.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "utterance.h"
+#include "jndslam_std.h"
+#include "jndslam_io.h"
+#include "jndslam_style.h"
+#include "jndslam_speaker.h"
+#include "jndslam_corpus.h"
+
+// A resident server that stylises one utterance per request so a caller does not pay for starting
+// a process and finding reference pitches every time. Requests are lines of space separated fields:
+//
+//   FILE id lab_path f0_path [speaker]
+//     Stylise the utterance in these input files.
+//   INLINE id lab_bytes f0_bytes [speaker]
+//     Followed by exactly lab_bytes of lab file and f0_bytes of EST pitch file.
+//
+// For each algorithm the reply is a line "OK id algorithm length" followed by length bytes of
+// stylisation as written to a .sty file. A request that fails gets a single "ERROR id message" line.
+// Utterances are stylised relative to the reference pitch of their speaker loaded at start.
+
+// Serve requests read from in_fd and reply on out_fd until in_fd ends
+void serve_stream(int in_fd, int out_fd, global_args_t &args, const speaker_stats &reference);
+
+// Listen on a Unix domain socket and serve each connection on its own thread. Runs until killed.
+// Throws if the socket can not be made.
+void serve_socket(const std::string &path, global_args_t &args, const speaker_stats &reference);
+
+#endif
@@ -14,178 +14,215 @@
 
 #include "jndslam_smooth.h"
 
-// Smoothing using LOWESS
-// This is closely based on the following C# implementation http://stackoverflow.com/questions/5651709/c-sharp-loess-lowess-regression
-// But adapted to current use. This also explains the insistence on the use of doubles over floats which isn't really necessary.
-void smooth(std::vector<std::vector<float> > &pitchs, float smoothing_span, unsigned int iters, bool ignore_unvoiced)
+smooth_params::smooth_params()
+{
+  this->span = 0.2;
+  this->iters = 3;
+  this->tolerance = 1e-3;
+  this->ignore_unvoiced = false;
+  this->delta = 0;
+  this->verify = false;
+  this->simd = SIMD_AUTO;
+  this->single_precision = false;
+  this->scope = SCOPE_SEGMENT;
+}
+
+smooth_stats::smooth_stats()
+{
+  this->segments = 0;
+  this->fits = 0;
+  this->interpolated = 0;
+  this->robustness_iterations = 0;
+  this->max_delta_error = 0;
+}
+
+// Scratch space for smooth(). It is kept between calls so smoothing does not allocate for every segment.
+struct smooth_workspace
 {
-  // Check if smoothing_span is valid
-  if (smoothing_span < 0 || smoothing_span > 1)
-  {
-    throw std::invalid_argument("Smoothing span must be between 0 and 1 I got "+std::to_string(smoothing_span));
-  }
-  // Create x and y vectors
   std::vector<double> x_vals;
   std::vector<double> y_vals;
-  // Counter for number of voiced segments, only used if ignoring unvoiced segments.
-  int v_count = 0;
-  for (int i = 0; i < pitchs.size(); i++)
+  std::vector<size_t> frame_index;
+  std::vector<double> result;
+  std::vector<double> full_result;
+  std::vector<double> residuals;
+  std::vector<double> robustness_weights;
+  std::vector<double> median_residuals;
+  // Single precision copies for the float kernel
+  std::vector<float> x_float;
+  std::vector<float> y_float;
+  std::vector<float> robustness_weights_float;
+  // The smoothed track of a whole utterance and how many voiced frames come before each frame
+  pitch_track utt_pitch;
+  std::vector<size_t> voiced_before;
+};
+
+static thread_local smooth_workspace workspace;
+
+// Compute a least-squares linear fit at point j of x_vals over the points from left to right.
+// The weighted sums are left to the kernel so T may be double or float.
+template <typename T, typename Kernel>
+static double fit_point(const T *x_vals, const T *y_vals, const T *robustness_weights, int j, int left, int right, Kernel kernel)
+{
+  T x = x_vals[j];
+  
+  // Find the point in the interval farthest from x
+  int edge;
+  if (x - x_vals[left] > x_vals[right] - x)
   {
-    // If we ignore unvoiced segments each X is evenly spaced
-    if (ignore_unvoiced && pitchs[i][1] == 1)
-    {
-      // X-value
-      x_vals.push_back((double)v_count);
-      v_count++;
-      // Y-value
-      y_vals.push_back((double)pitchs[i][2]);
-    }
-    else if (pitchs[i][1] == 1) // If we don't ignore them we use the x in ms
-    {
-      // X-value
-      x_vals.push_back((double)pitchs[i][0]);
-      // Y-value
-      y_vals.push_back((double)pitchs[i][2]);
-    }
+    edge = left;
   }
-  // The number of datapoints
-  const int n = x_vals.size();
-  // If we have 0 datapoints this is unvoiced and we simply clear pitchs and return (stylise will pick up on this)
-  if (n == 0)
+  else
   {
-    pitchs.clear();
-    return void();
+    edge = right;
   }
-  else if (n == 1) // We can return early if n is 1 or 2 - In fact we can currently just clear pitchs atm but later this is better.
+  
+  // Compute a least-squares linear fit weighted by
+  // the product of robustness weights and the tricube
+  // weight function.
+  // See http://en.wikipedia.org/wiki/Linear_regression
+  // (section "Univariate linear case")
+  // and http://en.wikipedia.org/wiki/Weighted_least_squares
+  // (section "Weighted least squares")
+  T denom = std::fabs(1 / (x_vals[edge] - x));
+  lowess_sums sums;
+  kernel(x_vals + left, y_vals + left, robustness_weights + left, right - left + 1, x, denom, sums);
+  
+  // Every neighbour can be an outlier with a robustness weight of 0. There is nothing to fit
+  // then so the point keeps its own value, as lowess in R does.
+  if (sums.weights <= 0)
   {
-    std::vector<std::vector<float> > new_pitch;
-    new_pitch.push_back({(float)pitchs[x_vals[0]][0], 1, (float)y_vals[0]});
-    pitchs.swap(new_pitch);
-    return void();
+    return y_vals[j];
   }
-  else if (n == 2)
+  
+  double mean_x = sums.x / sums.weights;
+  double mean_y = sums.y / sums.weights;
+  double mean_xy = sums.xy / sums.weights;
+  double mean_x_squared = sums.x_squared / sums.weights;
+  double beta;
+  if (mean_x_squared == mean_x * mean_x)
   {
-    std::vector<std::vector<float> > new_pitch;
-    new_pitch.push_back({(float)pitchs[x_vals[0]][0], 1, (float)y_vals[0]});
-    new_pitch.push_back({(float)pitchs[x_vals[1]][0], 1, (float)y_vals[1]});
-    pitchs.swap(new_pitch);
-    return void();
+      beta = 0;
   }
-  // The smoothing window as determined by the smoothing span
-  int smoothing_window = ceil((float)n * smoothing_span);
-  // We need a window of at least two points
-  // Other implementations ignore this or throw an exception.
-  // We simply set it to two in this case.
-  if (smoothing_window < 2)
+  else
   {
-    smoothing_window = 2;
+      beta = (mean_xy - mean_x * mean_y) / (mean_x_squared - mean_x * mean_x);
   }
   
-  // Parameters
-  double result [n];
-  double residuals [n];
-  double robustness_weights [n];
+  double alpha = mean_y - beta * mean_x;
   
-  // Set all weights to 1.
-  for (int i = 0; i < n; i++)
+  return beta * x + alpha;
+}
+
+// LOWESS of n points with the given smoothing window. The fitted curve is written to result.
+// If kernel_float is set the fits are done in single precision with it, otherwise with kernel.
+static void lowess(const double *x_vals, const double *y_vals, int n, int smoothing_window, unsigned int iters, double tolerance, double delta, double *result, lowess_kernel kernel, lowess_kernel_float kernel_float, smooth_stats &stats)
+{
+  std::vector<double> &residuals = workspace.residuals;
+  std::vector<double> &robustness_weights = workspace.robustness_weights;
+  residuals.resize(n);
+  
+  // Centre x on the segment so times far into an utterance keep their precision as floats
+  std::vector<float> &x_float = workspace.x_float;
+  std::vector<float> &y_float = workspace.y_float;
+  std::vector<float> &robustness_weights_float = workspace.robustness_weights_float;
+  if (kernel_float)
   {
-    robustness_weights[i] = 1;
+    double centre = (x_vals[0] + x_vals[n - 1]) / 2;
+    x_float.resize(n);
+    y_float.resize(n);
+    robustness_weights_float.resize(n);
+    for (int z = 0; z < n; z++)
+    {
+      x_float[z] = (float)(x_vals[z] - centre);
+      y_float[z] = (float)y_vals[z];
+    }
   }
+  
+  // Set all weights to 1.
+  robustness_weights.assign(n, 1);
   // Do [iters] + 1 fits. I.e. we do an initial fit with all weights at 1 then [iter] additional fits.
   for (int i = 0; i <= iters; i++)
   {
-    int smoothing_interval [2] = {0, smoothing_window - 1};
-    // At each x, compute a local weighted linear regression
-    for (int j = 0; j < n; j++)
+    if (kernel_float)
+    {
+      for (int z = 0; z < n; z++)
+      {
+        robustness_weights_float[z] = (float)robustness_weights[z];
+      }
+    }
+    
+    // The interval of source points on which a regression is made
+    int left = 0;
+    int right = smoothing_window - 1;
+    // The last point we fitted, the points between it and the next fitted point are interpolated
+    int last = -1;
+    int j = 0;
+    while (true)
     {
       double x = x_vals[j];
       
-      // Find out the interval of source points on which
-      // a regression is to be made.
-      if (j > 0)
+      // Slide the interval forward while the next point to the right
+      // is closer to x than the leftmost point of the interval.
+      // As x only grows the interval never needs to move back.
+      while (right < n - 1 && x_vals[right + 1] - x < x - x_vals[left])
       {
-        // the implementation this is based on forgets to check left side.
-        int left = smoothing_interval[0];
-        int right = smoothing_interval[1];
-        // The edges should be adjusted if the previous point to the left
-        // is closer to x than the current point to the right
-        if (left != 0 && x - x_vals[left - 1] < x_vals[right] - x)
-        {
-          smoothing_interval[0]++;
-          smoothing_interval[1]++;
-        }
-        // The edges should be adjusted if the next point to the right
-        // is closer to x than the leftmost point of the current interval
-        else if (right < n - 1 && x_vals[right + 1] - x < x - x_vals[left])
-        {
-          smoothing_interval[1]++;
-          smoothing_interval[0]++;
-        }
+        left++;
+        right++;
       }
       
-      // Find the point in smoothing_interval farthest from x
-      int left = smoothing_interval[0];
-      int right = smoothing_interval[1];
-      int edge;
-      if (x - x_vals[left] > x_vals[right] - x)
+      if (kernel_float)
       {
-        edge = left;
+        result[j] = fit_point(x_float.data(), y_float.data(), robustness_weights_float.data(), j, left, right, kernel_float);
       }
       else
       {
-        edge = right;
+        result[j] = fit_point(x_vals, y_vals, robustness_weights.data(), j, left, right, kernel);
       }
+      stats.fits++;
       
-      // Compute a least-squares linear fit weighted by
-      // the product of robustness weights and the tricube
-      // weight function.
-      // See http://en.wikipedia.org/wiki/Linear_regression
-      // (section "Univariate linear case")
-      // and http://en.wikipedia.org/wiki/Weighted_least_squares
-      // (section "Weighted least squares")
-      double sum_weights = 0;
-      double sum_x = 0, sum_x_squared = 0, sum_y = 0, sum_xy = 0;
-      double denom = abs(1.0 / (x_vals[edge] - x));
-      for (int k = left; k <= right; ++k)
+      // Linearly interpolate the skipped points between the last fit and this one
+      if (last >= 0 && j - last > 1)
       {
-        double xk = x_vals[k];
-        double yk = y_vals[k];
-        double dist;
-        if (k < j)
+        double width = x_vals[j] - x_vals[last];
+        for (int k = last + 1; k < j; k++)
         {
-            dist = (x - xk);
+          double alpha = (x_vals[k] - x_vals[last]) / width;
+          result[k] = alpha * result[j] + (1 - alpha) * result[last];
+          stats.interpolated++;
         }
-        else
-        {
-            dist = (xk - x);
-        }
-        double w = tricube(dist * denom) * robustness_weights[k];
-        double xkw = xk * w;
-        sum_weights += w;
-        sum_x += xkw;
-        sum_x_squared += xk * xkw;
-        sum_y += yk * w;
-        sum_xy += yk * xkw;
+      }
+      last = j;
+      if (last >= n - 1)
+      {
+        break;
       }
       
-      double mean_x = sum_x / sum_weights;
-      double mean_y = sum_y / sum_weights;
-      double mean_xy = sum_xy / sum_weights;
-      double mean_x_squared = sum_x_squared / sum_weights;
-      double beta;
-      if (mean_x_squared == mean_x * mean_x)
+      // Find the next point to fit. It is the last point within delta of this one
+      // unless that is the very next point. Points at the same x share a fit.
+      double cut = x_vals[last] + delta;
+      int k;
+      for (k = last + 1; k < n; k++)
       {
-          beta = 0;
+        if (x_vals[k] > cut)
+        {
+          break;
+        }
+        if (x_vals[k] == x_vals[last])
+        {
+          result[k] = result[last];
+          last = k;
+        }
       }
-      else
+      if (last >= n - 1)
       {
-          beta = (mean_xy - mean_x * mean_y) / (mean_x_squared - mean_x * mean_x);
+        break;
       }
-      
-      double alpha = mean_y - beta * mean_x;
-      
-      result[j] = beta * x + alpha;
-      residuals[j] = abs(y_vals[j] - result[j]);
+      j = std::max(last + 1, k - 1);
+    }
+    
+    for (int z = 0; z < n; z++)
+    {
+      residuals[z] = abs(y_vals[z] - result[z]);
     }
     
     // No need to recompute the robustness weights at the last
@@ -196,85 +233,237 @@ void smooth(std::vector<std::vector<float> > &pitchs, float smoothing_span, unsi
     }
 
     // Recompute the robustness weights.
-    // Find the median residual.
-    std::vector<double> sorted_residuals;
-    for (int z = 0; z < n; z++)
-    {
-      sorted_residuals.push_back(residuals[z]);
-    }
-    std::sort(sorted_residuals.begin(), sorted_residuals.end());
-    double median_residual = sorted_residuals[n / 2];
+    // Find the median residual. Only the middle element is needed so it is selected rather than sorted for.
+    std::vector<double> &median_residuals = workspace.median_residuals;
+    median_residuals.assign(residuals.begin(), residuals.end());
+    std::nth_element(median_residuals.begin(), median_residuals.begin() + n / 2, median_residuals.end());
+    double median_residual = median_residuals[n / 2];
 
     if (median_residual == 0)
     {
         break;
     }
 
+    // Stop once no weight changes by more than the tolerance as another fit would change little
+    double largest_change = 0;
     for (int z = 0; z < n; z++)
     {
-      double arg = residuals[i] / (6 * median_residual);
-      robustness_weights[i] = (arg >= 1) ? 0 : pow(1 - arg * arg, 2);
+      double arg = residuals[z] / (6 * median_residual);
+      double weight = (arg >= 1) ? 0 : pow(1 - arg * arg, 2);
+      largest_change = std::max(largest_change, (double)abs(weight - robustness_weights[z]));
+      robustness_weights[z] = weight;
+    }
+    if (largest_change < tolerance)
+    {
+      break;
+    }
+    stats.robustness_iterations++;
+  }
+}
+
+// Smoothing using LOWESS
+// This is closely based on the following C# implementation http://stackoverflow.com/questions/5651709/c-sharp-loess-lowess-regression
+// But adapted to current use. This also explains the insistence on the use of doubles over floats which isn't really necessary.
+void smooth(pitch_span frames, pitch_track &out, smooth_params &params, smooth_stats &stats)
+{
+  // Check if smoothing_span is valid
+  if (params.span < 0 || params.span > 1)
+  {
+    throw std::invalid_argument("Smoothing span must be between 0 and 1 I got "+std::to_string(params.span));
+  }
+  if (params.delta < 0)
+  {
+    throw std::invalid_argument("Smoothing delta must not be negative I got "+std::to_string(params.delta));
+  }
+  // Create x and y vectors
+  std::vector<double> &x_vals = workspace.x_vals;
+  std::vector<double> &y_vals = workspace.y_vals;
+  // Which frame each x and y came from
+  std::vector<size_t> &frame_index = workspace.frame_index;
+  x_vals.clear();
+  y_vals.clear();
+  frame_index.clear();
+  // Counter for number of voiced segments, only used if ignoring unvoiced segments.
+  int v_count = 0;
+  for (size_t i = 0; i < frames.size; i++)
+  {
+    // If we ignore unvoiced segments each X is evenly spaced
+    if (params.ignore_unvoiced && frames.voicing[i] == 1)
+    {
+      // X-value
+      x_vals.push_back((double)v_count);
+      v_count++;
+      // Y-value
+      y_vals.push_back((double)frames.f0[i]);
+      frame_index.push_back(i);
+    }
+    else if (frames.voicing[i] == 1) // If we don't ignore them we use the x in ms
+    {
+      // X-value
+      x_vals.push_back((double)frames.times[i]);
+      // Y-value
+      y_vals.push_back((double)frames.f0[i]);
+      frame_index.push_back(i);
+    }
+  }
+  // The number of datapoints
+  const int n = x_vals.size();
+  // If we have 0 datapoints this is unvoiced and we add nothing (stylise will pick up on this)
+  // We can return early if n is 1 or 2 as there is nothing to smooth.
+  if (n <= 2)
+  {
+    for (int i = 0; i < n; i++)
+    {
+      out.push_back(frames.times[frame_index[i]], 1, (float)y_vals[i]);
+    }
+    return void();
+  }
+  // The smoothing window as determined by the smoothing span
+  int smoothing_window = ceil((float)n * params.span);
+  // We need a window of at least two points
+  // Other implementations ignore this or throw an exception.
+  // We simply set it to two in this case.
+  if (smoothing_window < 2)
+  {
+    smoothing_window = 2;
+  }
+  
+  // Pick the fitting kernel for this CPU
+  lowess_kernel kernel = select_lowess_kernel(params.simd);
+  lowess_kernel_float kernel_float = params.single_precision ? select_lowess_kernel_float(params.simd) : NULL;
+  
+  std::vector<double> &result = workspace.result;
+  result.resize(n);
+  stats.segments++;
+  lowess(x_vals.data(), y_vals.data(), n, smoothing_window, params.iters, params.tolerance, params.delta, result.data(), kernel, kernel_float, stats);
+  
+  // Compare against a fit of every point if asked to
+  if (params.verify && params.delta > 0)
+  {
+    std::vector<double> &full_result = workspace.full_result;
+    full_result.resize(n);
+    smooth_stats full_stats;
+    lowess(x_vals.data(), y_vals.data(), n, smoothing_window, params.iters, params.tolerance, 0, full_result.data(), kernel, kernel_float, full_stats);
+    for (int i = 0; i < n; i++)
+    {
+      stats.max_delta_error = std::max(stats.max_delta_error, (double)abs(result[i] - full_result[i]));
     }
   }
   
-  std::vector<std::vector<float> > new_pitch;
-  // Create a new pitchs with the calculated curve
+  // Add the calculated curve to out
   for (int i = 0; i < n; i++)
   {
-    //std::cout << result[i] << std::endl;
-    new_pitch.push_back({(float)pitchs[x_vals[i]][0], 1, (float)result[i]});
+    out.push_back(frames.times[frame_index[i]], 1, (float)result[i]);
   }
-  pitchs.swap(new_pitch);
 }
 
 // Smooth all sylls in an utt
-void smooth_utt(typename utterance::utterance &utt)
+void smooth_utt(typename utterance::utterance &utt, smooth_params &params, smooth_stats &stats)
 {
-  //std::cout << utt.name << std::endl;
+  smooth_utt(utt, pitch_span(utt.frames, 0, utt.frames.size()), params, stats);
+}
+
+// Smooth the voiced pitch of each syll in an utt with its frames held elsewhere
+void smooth_utt(typename utterance::utterance &utt, pitch_span frames, smooth_params &params, smooth_stats &stats)
+{
+  if (params.scope == SCOPE_UTTERANCE)
+  {
+    smooth_whole_utt(utt, frames, params, stats);
+    return void();
+  }
+  // Each syllable gets its smoothed values appended to the pitch track
+  utt.pitch.clear();
+  utt.pitch.reserve(frames.size);
   for (int i = 0; i < utt.sylls.size(); i++)
   {
-    //std::cout << "Syll " << utt.sylls[i].identity << " " << i << std::endl;
-    smooth(utt.sylls[i].pitch_values);
+    utt.sylls[i].pitch_begin = utt.pitch.size();
+    smooth(frames.slice(utt.sylls[i].frames_begin, utt.sylls[i].frames_end), utt.pitch, params, stats);
+    utt.sylls[i].pitch_end = utt.pitch.size();
+  }
+}
+
+// Smooth the voiced frames of a whole utt at once and give each syll the smoothed values of its own frames
+void smooth_whole_utt(typename utterance::utterance &utt, pitch_span frames, smooth_params &params, smooth_stats &stats)
+{
+  pitch_track &smoothed = workspace.utt_pitch;
+  smoothed.clear();
+  smooth(frames, smoothed, params, stats);
+  
+  // smooth() keeps every voiced frame in order so the smoothed value of a frame
+  // is found by counting the voiced frames before it
+  std::vector<size_t> &voiced_before = workspace.voiced_before;
+  voiced_before.resize(frames.size + 1);
+  voiced_before[0] = 0;
+  for (size_t i = 0; i < frames.size; i++)
+  {
+    voiced_before[i + 1] = voiced_before[i] + (frames.voicing[i] == 1 ? 1 : 0);
+  }
+  
+  utt.pitch.clear();
+  utt.pitch.reserve(smoothed.size());
+  for (int i = 0; i < utt.sylls.size(); i++)
+  {
+    utt.sylls[i].pitch_begin = utt.pitch.size();
+    for (size_t k = voiced_before[utt.sylls[i].frames_begin]; k < voiced_before[utt.sylls[i].frames_end]; k++)
+    {
+      utt.pitch.push_back(smoothed.times[k], smoothed.voicing[k], smoothed.f0[k]);
+    }
+    utt.sylls[i].pitch_end = utt.pitch.size();
   }
 }
 
 // Smooth all sylls in all utts in a list of utts
-void smooth_utts(std::vector<typename utterance::utterance> &utts)
+void smooth_utts(std::vector<typename utterance::utterance> &utts, smooth_params &params, smooth_stats &stats)
 {
   for (int i = 0; i < utts.size(); i++)
   {
-    smooth_utt(utts[i]);
+    smooth_utt(utts[i], params, stats);
   }
 }
 
-// Compute the tricube
-// weight function
-// http://en.wikipedia.org/wiki/Local_regression#Weight_function
-static double tricube(double x)
+// Add the counters in part to total
+void add_smooth_stats(smooth_stats &total, const smooth_stats &part)
 {
-  double tmp = 1 - abs(x) * abs(x) * abs(x);
-  return tmp * tmp * tmp;
+  total.segments += part.segments;
+  total.fits += part.fits;
+  total.interpolated += part.interpolated;
+  total.robustness_iterations += part.robustness_iterations;
+  total.max_delta_error = std::max(total.max_delta_error, part.max_delta_error);
 }
 
 // Removes all unvoiced pitch values.
 // Used when not performing smoothing.
 void remove_unvoiced(std::vector<typename utterance::utterance> &utts)
 {
-  std::vector<std::vector<float> > new_pitchs;
   for (int i = 0; i < utts.size(); i++)
   {
-    for (int j = 0; j < utts[i].sylls.size(); j++)
+    remove_unvoiced_utt(utts[i]);
+  }
+}
+
+// Removes all unvoiced pitch values in an utt.
+void remove_unvoiced_utt(typename utterance::utterance &utt)
+{
+  remove_unvoiced_utt(utt, pitch_span(utt.frames, 0, utt.frames.size()));
+}
+
+// Removes all unvoiced pitch values in an utt with its frames held elsewhere
+void remove_unvoiced_utt(typename utterance::utterance &utt, pitch_span all_frames)
+{
+  // Each syllable gets its voiced frames appended to the pitch track
+  utt.pitch.clear();
+  utt.pitch.reserve(all_frames.size);
+  for (int j = 0; j < utt.sylls.size(); j++)
+  {
+    pitch_span frames = all_frames.slice(utt.sylls[j].frames_begin, utt.sylls[j].frames_end);
+    utt.sylls[j].pitch_begin = utt.pitch.size();
+    for (size_t z = 0; z < frames.size; z++)
     {
-      new_pitchs.clear();
-      
-      for (int z = 0; z < utts[i].sylls[j].pitch_values.size(); z++)
+      if (frames.voicing[z] == 1)
       {
-        if (utts[i].sylls[j].pitch_values[z][1] == 1)
-        {
-          new_pitchs.push_back(utts[i].sylls[j].pitch_values[z]);
-        }
+        utt.pitch.push_back(frames.times[z], frames.voicing[z], frames.f0[z]);
       }
-      utts[i].sylls[j].pitch_values.swap(new_pitchs);
     }
+    utt.sylls[j].pitch_end = utt.pitch.size();
   }
 }
@@ -24,26 +24,99 @@
 #include <math.h>
 
 #include "utterance.h"
+#include "pitch_track.h"
+#include "jndslam_kernel.h"
+
+// What each smoothing fit covers, a single segment or the whole utterance
+enum Smooth_Scope {SCOPE_SEGMENT, SCOPE_UTTERANCE};
+
+// Parameters for smooth()
+struct smooth_params
+{
+public:
+  smooth_params();
+  // The fraction of points used for each local fit. Must be between 0 and 1.
+  float span;
+  // The largest number of robustness iterations
+  unsigned int iters;
+  // Robustness iterations stop early once no robustness weight changes by this much
+  double tolerance;
+  // Space voiced points evenly and ignore the unvoiced gaps between them
+  bool ignore_unvoiced;
+  // Points closer than delta to the last fitted point are linearly interpolated instead of fitted,
+  // as with the delta argument of lowess in R. Measured in seconds, or in frames if ignore_unvoiced is set.
+  // 0 fits every point.
+  double delta;
+  // Also do a full fit of every point and record the largest difference from it in the stats
+  bool verify;
+  // The instruction set of the fitting kernel. Every level gives the same result in double precision.
+  Simd_Level simd;
+  // Fit in single precision on times centred on the segment. Faster but the result differs slightly.
+  bool single_precision;
+  // Smooth each segment on its own or the whole utterance at once
+  Smooth_Scope scope;
+};
+
+// Counters for how much work smooth() did
+struct smooth_stats
+{
+public:
+  smooth_stats();
+  // Number of segments that had enough points to be smoothed
+  unsigned long segments;
+  // Number of local regressions computed
+  unsigned long fits;
+  // Number of points interpolated rather than fitted due to delta
+  unsigned long interpolated;
+  // Number of refits with robustness weights
+  unsigned long robustness_iterations;
+  // Largest absolute difference between the delta fit and a full fit. Only found if verify is set.
+  double max_delta_error;
+};
 
 // Smoothing using LOWESS
 // This is closely based on the following C# implementation http://stackoverflow.com/questions/5651709/c-sharp-loess-lowess-regression
 // But adapted to current use. This also explains the insistence on the use of doubles over floats which isn't really necessary.
-// This modifies the current pitch values in pitchs, the smoothing span must be between 1 and 0. Current default value follows implementation
+// The voiced frames in frames are appended to out with their smoothed pitch values, the smoothing span must be between 1 and 0. Current default value follows implementation
 // in https://github.com/jbeliao/SLAM . It is low compared to C# implementation recommendation of 0.25 to 0.5. Its default is 0.3.
 // The bigger the span the larger a smoothing window.
-// Iters is the number of robustness iterations, default based on other implementations.
+// Iters is the largest number of robustness iterations, default based on other implementations.
+// Fewer are done if the robustness weights settle to within the tolerance first.
 // Ignore_unvoiced is implementation specific and if true the distance between unvoiced sections is not taken into account when smoothing.
 // Default is set to false as we wish this distance (in ms) to matter. However the original SLAM implementation in https://github.com/jbeliao/SLAM
 // does not do this as far as I can see (so would be equivalent to set to true).
-void smooth(std::vector<std::vector<float> > &pitchs, float smoothing_span=0.2, unsigned int iters=3, bool ignore_unvoiced=false);
+// The window of neighbours slides forward with the point being fitted so it is never searched for from scratch.
+// With a delta of 0 every point is fitted. With a larger delta only points more than delta apart are fitted and the rest
+// interpolated which makes smoothing close to linear in the number of points for long segments. The error at an interpolated
+// point is at most delta^2/8 times the largest curvature of the smoothed curve between its two fitted neighbours.
+// Set verify in params to measure the actual error in stats.
+// The weighted sums of each fit are computed by a vector kernel chosen for the CPU at runtime, see jndslam_kernel.h.
+void smooth(pitch_span frames, pitch_track &out, smooth_params &params, smooth_stats &stats);
+
+// Smooth the voiced pitch of each syll in an utt into utt.pitch. With a scope of SCOPE_UTTERANCE
+// this is smooth_whole_utt() otherwise each syll is smoothed on its own.
+void smooth_utt(typename utterance::utterance &utt, smooth_params &params, smooth_stats &stats);
 
-void smooth_utt(typename utterance::utterance &utt);
+// The same with the frames of the utt held elsewhere, e.g. by a caller of the library.
+// The frame ranges of the sylls index into frames.
+void smooth_utt(typename utterance::utterance &utt, pitch_span frames, smooth_params &params, smooth_stats &stats);
 
-void smooth_utts(std::vector<typename utterance::utterance> &utts);
+// Smooth the voiced track of a whole utt once and give each syll its portion, as the original SLAM does.
+// There are no edge effects at syll boundaries and far fewer but larger fits.
+void smooth_whole_utt(typename utterance::utterance &utt, pitch_span frames, smooth_params &params, smooth_stats &stats);
+
+void smooth_utts(std::vector<typename utterance::utterance> &utts, smooth_params &params, smooth_stats &stats);
+
+// Add the counters in part to total
+void add_smooth_stats(smooth_stats &total, const smooth_stats &part);
 
 // A method for removing unvoiced segments from the pitch values.
 void remove_unvoiced(std::vector<typename utterance::utterance> &utts);
 
-static double tricube(double x);
+// Remove unvoiced segments from the pitch values of all sylls in an utt.
+void remove_unvoiced_utt(typename utterance::utterance &utt);
+
+// The same with the frames of the utt held elsewhere
+void remove_unvoiced_utt(typename utterance::utterance &utt, pitch_span frames);
 
 #endif
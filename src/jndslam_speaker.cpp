@@ -0,0 +1,89 @@
+/* Copyright 2015 Rasmus Dall - rasmus@dall.dk
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+
+#include "jndslam_speaker.h"
+
+// The mean pitch of a speaker
+float speaker_mean_pitch(const speaker_stats &stats, const std::string &speaker)
+{
+  speaker_stats::const_iterator it = stats.find(speaker);
+  if (it == stats.end())
+  {
+    throw std::invalid_argument("No reference pitch for speaker "+(speaker.empty() ? NO_SPEAKER_NAME : speaker));
+  }
+  pitch_sum sum = it->second;
+  return calc_mean_pitch(sum);
+}
+
+// Find the speaker of an utterance from its name
+bool speaker_from_name(const std::regex &pattern, const std::string &name, std::string &speaker)
+{
+  std::smatch match;
+  if (!std::regex_search(name, match, pattern))
+  {
+    return false;
+  }
+  speaker = match.size() > 1 ? match[1].str() : match[0].str();
+  return true;
+}
+
+// Write stats to a file
+void save_speaker_stats(const std::string &path, const speaker_stats &stats)
+{
+  std::string contents;
+  for (speaker_stats::const_iterator it = stats.begin(); it != stats.end(); ++it)
+  {
+    char buffer[128];
+    snprintf(buffer, sizeof(buffer), " %lu %a %a\n", it->second.count, it->second.sum, it->second.compensation);
+    contents += (it->first.empty() ? NO_SPEAKER_NAME : it->first) + buffer;
+  }
+  write_file(path, contents);
+}
+
+// Read stats written by save_speaker_stats
+speaker_stats load_speaker_stats(const std::string &path)
+{
+  mapped_file file(path);
+  text_view text = file.text();
+  speaker_stats stats;
+  std::vector<text_view> fields;
+  text_view line;
+  for (size_t i = 0; next_line(text, line); i++)
+  {
+    if (line.empty())
+    {
+      continue;
+    }
+    split_view(line, fields, ' ');
+    if (fields.size() != 4)
+    {
+      throw std::invalid_argument("Line "+std::to_string(i + 1)+" of stats file "+path+" is malformed.");
+    }
+    pitch_sum sum;
+    try
+    {
+      sum.count = std::stoul(fields[1].str());
+      sum.sum = std::stod(fields[2].str());
+      sum.compensation = std::stod(fields[3].str());
+    }
+    catch (const std::exception &e)
+    {
+      throw std::invalid_argument("Line "+std::to_string(i + 1)+" of stats file "+path+" is malformed.");
+    }
+    std::string speaker = fields[0].str();
+    stats[speaker == NO_SPEAKER_NAME ? std::string() : speaker] = sum;
+  }
+  return stats;
+}
@@ -0,0 +1,53 @@
+/* Copyright 2015 Rasmus Dall - rasmus@dall.dk
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+
+#ifndef JNDSLAM_SPEAKER_H
+#define JNDSLAM_SPEAKER_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <regex>
+#include <stdexcept>
+
+#include <stdio.h>
+
+#include "jndslam_std.h"
+#include "jndslam_io.h"
+#include "jndslam_style.h"
+
+// The reference pitch of every speaker in a corpus. Utterances are stylised relative to the mean
+// pitch of their own speaker. Utterances with no known speaker share the speaker "".
+typedef std::map<std::string, pitch_sum> speaker_stats;
+
+// The name a stats file uses for the speaker ""
+const std::string NO_SPEAKER_NAME = "-";
+
+// The mean pitch of a speaker. Throws if there are no stats for the speaker.
+float speaker_mean_pitch(const speaker_stats &stats, const std::string &speaker);
+
+// Find the speaker of an utterance from its name. With a capture group in pattern the speaker is
+// what the first group matched, otherwise what the whole pattern matched. E.g. with "^[a-z]+"
+// the speaker of awb_a0001 is awb. Returns false if the pattern does not match the name.
+bool speaker_from_name(const std::regex &pattern, const std::string &name, std::string &speaker);
+
+// Write stats to a file, one "speaker frames sum compensation" line per speaker in hex floating
+// point so they load exactly. Throws if the file can not be written.
+void save_speaker_stats(const std::string &path, const speaker_stats &stats);
+
+// Read stats written by save_speaker_stats. Throws if the file can not be read or is malformed.
+speaker_stats load_speaker_stats(const std::string &path);
+
+#endif
@@ -33,24 +33,138 @@ std::vector<std::string> split_string(std::string str, char delim, bool empty)
 }
 
 
-// Get a slice of a vector
-// Ignores values out of range with a warning.
-std::vector<std::vector<float> > slice_vector(std::vector<std::vector<float> > &vec, int start, int end)
+// Split a view on a delimiter. Optionally include empty splits, whitespace is default delimiter.
+void split_view(text_view str, std::vector<text_view> &out_vec, char delim, bool empty)
 {
-  std::vector<std::vector<float> > out_vec;
-  
-  for (int i = start; i <= end; i++)
+  out_vec.clear();
+  const char *start = str.data;
+  const char *end = str.data + str.size;
+  while (start != end)
   {
-    try
+    const char *split = std::find(start, end, delim);
+    if (empty == true || split != start)
     {
-      out_vec.push_back(vec.at(i));
+      out_vec.push_back(text_view(start, split - start));
     }
-    catch (const std::out_of_range &oor)
+    // Like getline a trailing delimiter does not give an empty split
+    if (split == end)
     {
-      std::cerr << "WARNING! Out of Range when getting slice from " << start << " to " << end << " at " << i << " Skipping..\n";
+      break;
     }
+    start = split + 1;
   }
-  
-  return out_vec;
 }
 
+// Get the next line of text
+bool next_line(text_view &text, text_view &line)
+{
+  if (text.data == NULL)
+  {
+    return false;
+  }
+  const char *end = text.data + text.size;
+  const char *newline = std::find(text.data, end, '\n');
+  line = text_view(text.data, newline - text.data);
+  if (newline == end)
+  {
+    // Like getline this was the last line
+    text = text_view();
+  }
+  else
+  {
+    text = text_view(newline + 1, end - newline - 1);
+  }
+  return true;
+}
+
+// Numbers in views are not null terminated so we copy them somewhere that is first.
+// Anything longer than this is not a number we can make sense of anyway.
+static const size_t MAX_NUMBER_LENGTH = 64;
+
+static void view_to_cstr(text_view str, char *buf)
+{
+  size_t len = std::min(str.size, MAX_NUMBER_LENGTH - 1);
+  std::memcpy(buf, str.data, len);
+  buf[len] = '\0';
+}
+
+// Convert a view of a number to a float
+float view_to_float(text_view str)
+{
+  char buf[MAX_NUMBER_LENGTH];
+  view_to_cstr(str, buf);
+  return std::atof(buf);
+}
+
+// Convert a view of a number to an int
+int view_to_int(text_view str)
+{
+  char buf[MAX_NUMBER_LENGTH];
+  view_to_cstr(str, buf);
+  return std::atoi(buf);
+}
+
+// Convert a view of a number to a 64 bit int
+int64_t view_to_int64(text_view str)
+{
+  char buf[MAX_NUMBER_LENGTH];
+  view_to_cstr(str, buf);
+  return std::atoll(buf);
+}
+
+text_view::text_view()
+{
+  this->data = NULL;
+  this->size = 0;
+}
+
+text_view::text_view(const char *data, size_t size)
+{
+  this->data = data;
+  this->size = size;
+}
+
+text_view::text_view(const std::string &str)
+{
+  this->data = str.data();
+  this->size = str.size();
+}
+
+bool text_view::empty() const
+{
+  return this->size == 0;
+}
+
+std::string text_view::str() const
+{
+  return std::string(this->data, this->size);
+}
+
+size_t text_view::find(const std::string &needle, size_t pos) const
+{
+  if (pos > this->size)
+  {
+    return std::string::npos;
+  }
+  const char *end = this->data + this->size;
+  const char *found = std::search(this->data + pos, end, needle.begin(), needle.end());
+  if (found == end && !needle.empty())
+  {
+    return std::string::npos;
+  }
+  return found - this->data;
+}
+
+text_view text_view::substr(size_t pos, size_t len) const
+{
+  if (pos > this->size)
+  {
+    throw std::out_of_range("text_view::substr position "+std::to_string(pos)+" is past the end of the view.");
+  }
+  return text_view(this->data + pos, std::min(len, this->size - pos));
+}
+
+bool text_view::operator==(const char *other) const
+{
+  return std::strlen(other) == this->size && std::memcmp(this->data, other, this->size) == 0;
+}
@@ -20,12 +20,45 @@
 #include <sstream>
 #include <stdexcept>
 #include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <stdint.h>
+
+// A non-owning view of a piece of text, e.g. a line in a memory mapped file.
+// The text is not null terminated and must outlive the view.
+struct text_view
+{
+public:
+  text_view();
+  text_view(const char *data, size_t size);
+  explicit text_view(const std::string &str);
+  const char *data;
+  size_t size;
+  bool empty() const;
+  // Copy the text into a string
+  std::string str() const;
+  // Find the first occurence of needle at or after pos. Returns std::string::npos if there is none.
+  size_t find(const std::string &needle, size_t pos=0) const;
+  // Get a view of part of this view. Like std::string::substr the length is clipped to the end of the view.
+  text_view substr(size_t pos, size_t len=std::string::npos) const;
+  bool operator==(const char *other) const;
+};
 
 // Split a string based on a delimiter. Whitespace is default delimiter and you can optionally include empty splits.
 std::vector<std::string> split_string(std::string str, char delim=' ', bool empty=false);
 
-// Slice a vector of vector<string>.
-// Ignores out-of-range requests with an error.
-std::vector<std::vector<float> > slice_vector(std::vector<std::vector<float> > &vec, int start, int end);
+// Split a view based on a delimiter into views of the same text. Works like split_string but
+// fills out_vec (which is cleared first) so it can be reused without allocating for every line.
+void split_view(text_view str, std::vector<text_view> &out_vec, char delim=' ', bool empty=false);
+
+// Get the next line of text. Returns false when there is no text left.
+// The line is cut from the front of text and does not include the newline.
+bool next_line(text_view &text, text_view &line);
+
+// Convert a view of a number to a float or int like atof and atoi.
+float view_to_float(text_view str);
+int view_to_int(text_view str);
+int64_t view_to_int64(text_view str);
 
 #endif
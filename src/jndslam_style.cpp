@@ -20,508 +20,508 @@ void stylise(std::vector<typename utterance::utterance> &utts, Style_Alg algorit
 {
   // Get the mean f0 of the speaker
   float mean_pitch = calc_mean_pitch(utts);
-  // For each utterance
-  for (int i = 0; i < utts.size(); i++)
+  switch (algorithm)
+  {
+    case SIMPLIFIED:
+      stylise_utts<simplified_policy>(utts, mean_pitch);
+      break;
+    case JNDSLAM:
+      stylise_utts<jndslam_policy>(utts, mean_pitch);
+      break;
+    case SLAM:
+      stylise_utts<slam_policy>(utts, mean_pitch);
+      break;
+    case RAW:
+      stylise_utts<raw_policy>(utts, mean_pitch);
+      break;
+    default:
+      throw std::invalid_argument("This should never happen! The enum is - "+std::to_string(algorithm)+" - but it is not an option!");
+  }
+}
+
+// Stylise all syllables in an utterance relative to the mean pitch of the speaker
+void stylise_utt(typename utterance::utterance &utt, Style_Alg algorithm, float mean_pitch)
+{
+  switch (algorithm)
+  {
+    case SIMPLIFIED:
+      stylise_utt<simplified_policy>(utt, mean_pitch);
+      break;
+    case JNDSLAM:
+      stylise_utt<jndslam_policy>(utt, mean_pitch);
+      break;
+    case SLAM:
+      stylise_utt<slam_policy>(utt, mean_pitch);
+      break;
+    case RAW:
+      stylise_utt<raw_policy>(utt, mean_pitch);
+      break;
+    default:
+      throw std::invalid_argument("This should never happen! The enum is - "+std::to_string(algorithm)+" - but it is not an option!");
+  }
+}
+
+// Convert the pitch of each syllable to semitones and find its contour
+void find_contours(typename utterance::utterance &utt, float mean_pitch, std::vector<contour_stats> &contours)
+{
+  contours.resize(utt.sylls.size());
+  for (size_t j = 0; j < utt.sylls.size(); j++)
   {
-    typename utterance::utterance *tmp_utt = &utts[i];
-    // For each syllable in the utterance
-    for (int j = 0; j < tmp_utt->sylls.size(); j++)
+    pitch_span pitch = utt.syll_pitch(j);
+    
+    // If the syllable has less than 3 voiced frames it is unvoiced and there is nothing to find
+    if (pitch.size <= 3)
     {
-      typename syllable::syllable *tmp_syll = &tmp_utt->sylls[j];
-      
-      // If the syllable has less than 3 voiced frames we can assign unvoiced and continue to next
-      if (tmp_syll->pitch_values.size() <= 3)
-      {
-        tmp_syll->contour_start = "UNVOICED_START";
-        tmp_syll->contour_direction = "UNVOICED_DIRECTION";
-        tmp_syll->contour_extreme = "UNVOICED_EXTREME";
-        continue;
-      }
-      
-      // For each pitch value in the syllable
-      // Convert f0 values to semitones around the mean
-      for (int z = 0; z < tmp_syll->pitch_values.size(); z++)
-      {
-        if (tmp_syll->pitch_values[z][1] == 1)
-        {
-          //std::cout << "Prior " << tmp_syll->pitch_values[z][2];
-          tmp_syll->pitch_values[z][2] = f0_to_semitone(tmp_syll->pitch_values[z][2], mean_pitch);
-          //std::cout << " post " << tmp_syll->pitch_values[z][2];
-          //std::cout << " mean " << mean_pitch << "\n";
-        }
-      }
-      
-      if (algorithm == SIMPLIFIED)
-      {
-        style_simplified(*tmp_syll);
-      }
-      else if (algorithm == JNDSLAM)
-      {
-        style_jndslam(*tmp_syll);
-      }
-      else if (algorithm == SLAM)
-      {
-        style_slam(*tmp_syll);
-      }
-      else if (algorithm == RAW)
-      {
-        style_raw(*tmp_syll);
-      }
-      else
+      contours[j].voiced = false;
+      continue;
+    }
+    
+    // For each pitch value in the syllable
+    // Convert f0 values to semitones around the mean
+    for (size_t z = 0; z < pitch.size; z++)
+    {
+      if (pitch.voicing[z] == 1)
       {
-        throw std::invalid_argument("This should never happen! The enum is - "+std::to_string(algorithm)+" - but it is not an option!");
+        pitch.f0[z] = f0_to_semitone(pitch.f0[z], mean_pitch);
       }
-      
     }
+    
+    // One pass finds everything the algorithms need to know about the contour
+    contours[j] = find_contour(pitch);
   }
 }
 
-// Calculate the mean pitch of the speaker
-float calc_mean_pitch(std::vector<typename utterance::utterance> &utts)
+// Label a syllable unvoiced
+void style_unvoiced(typename syllable::syllable &syll)
 {
-  // How many pitch values are we adding together?
-  int count = 0;
-  // The sum of all pitch values
-  float sum = 0;
-  
-  // For each utterance
-  for (int i = 0; i < utts.size(); i++)
+  syll.contour_start = LABEL_UNVOICED_START;
+  syll.contour_direction = LABEL_UNVOICED_DIRECTION;
+  syll.contour_extreme = LABEL_UNVOICED_EXTREME;
+  syll.contour_extreme_pos = POS_NONE;
+}
+
+// Label every syllable of an utterance from its contour with an algorithm
+void style_contours(typename utterance::utterance &utt, const std::vector<contour_stats> &contours, Style_Alg algorithm)
+{
+  switch (algorithm)
+  {
+    case SIMPLIFIED:
+      style_contours<simplified_policy>(utt, contours);
+      break;
+    case JNDSLAM:
+      style_contours<jndslam_policy>(utt, contours);
+      break;
+    case SLAM:
+      style_contours<slam_policy>(utt, contours);
+      break;
+    case RAW:
+      style_contours<raw_policy>(utt, contours);
+      break;
+    default:
+      throw std::invalid_argument("This should never happen! The enum is - "+std::to_string(algorithm)+" - but it is not an option!");
+  }
+}
+
+// Convert an algorithm name to its enum
+Style_Alg style_alg_from_string(const std::string &name)
+{
+  if (name == "simplified")
   {
-    typename utterance::utterance *tmp_utt = &utts[i];
-    // For each syllable in the utterance
-    for (int j = 0; j < tmp_utt->sylls.size(); j++)
-    {
-      typename syllable::syllable *tmp_syll = &tmp_utt->sylls[j];
-      // For each pitch value in the syllable
-      if (tmp_syll->pitch_values.size() > 0)
-      {
-        for (int z = 0; z < tmp_syll->pitch_values.size(); z++)
-        {
-          if (tmp_syll->pitch_values[z][1] == 1)
-          {
-            sum = sum + tmp_syll->pitch_values[z][2];
-            count += 1;
-          }
-        }
-      }
-    }
+    return SIMPLIFIED;
   }
-  
-  if (count != 0)
+  else if (name == "jndslam")
   {
-    //std::cout << "Mean pitch is " << sum/count << "\n";
-    return sum/count;
+    return JNDSLAM;
   }
-  else
+  else if (name == "slam")
   {
-    return 0;
+    return SLAM;
   }
+  else if (name == "raw")
+  {
+    return RAW;
+  }
+  throw std::invalid_argument("Unknown stylisation algorithm "+name);
 }
 
-float f0_to_semitone(float &f0, float &mean_f0)
+// Convert an algorithm to its name
+std::string style_alg_to_string(Style_Alg algorithm)
 {
-  float semitones = 12*log2(f0/mean_f0);
-  return semitones;
+  switch (algorithm)
+  {
+    case SIMPLIFIED:
+      return "simplified";
+    case JNDSLAM:
+      return "jndslam";
+    case SLAM:
+      return "slam";
+    case RAW:
+      return "raw";
+    default:
+      throw std::invalid_argument("This should never happen! The enum is - "+std::to_string(algorithm)+" - but it is not an option!");
+  }
 }
 
-void style_simplified(typename syllable::syllable &syll)
+// Calculate the mean pitch of the speaker
+float calc_mean_pitch(std::vector<typename utterance::utterance> &utts)
 {
-  // Apply label to start position
-  float start_pitch = syll.pitch_values.front()[2];
-  if (start_pitch >= 1.5)
+  std::vector<pitch_sum> sums;
+  for (int i = 0; i < utts.size(); i++)
   {
-    syll.contour_start = "HIGH";
+    sums.push_back(calc_pitch_sum(utts[i]));
   }
-  else if (start_pitch > -1.5)
+  return calc_mean_pitch(sums);
+}
+
+// Sum the voiced pitch values of an utterance
+pitch_sum calc_pitch_sum(typename utterance::utterance &utt)
+{
+  pitch_sum out_sum = {0, 0, 0};
+  // For each syllable in the utterance
+  for (int j = 0; j < utt.sylls.size(); j++)
   {
-    syll.contour_start = "MEDIUM";
+    pitch_span pitch = utt.syll_pitch(j);
+    // For each pitch value in the syllable
+    for (size_t z = 0; z < pitch.size; z++)
+    {
+      if (pitch.voicing[z] == 1)
+      {
+        add_pitch_value(out_sum, pitch.f0[z]);
+      }
+    }
   }
-  else
+  return out_sum;
+}
+
+// Calculate the mean pitch from a list of partial sums
+float calc_mean_pitch(std::vector<pitch_sum> &sums)
+{
+  pitch_sum total = {0, 0, 0};
+  for (int i = 0; i < sums.size(); i++)
   {
-    syll.contour_start = "LOW";
+    add_pitch_sum(total, sums[i]);
   }
-  
-  // Apply label to direction
-  float direction_value = syll.pitch_values.back()[2] - syll.pitch_values.front()[2];
-  if (direction_value >= 1.5)
+  return calc_mean_pitch(total);
+}
+
+// Calculate the mean pitch from a sum
+float calc_mean_pitch(pitch_sum &sum)
+{
+  if (sum.count != 0)
   {
-    syll.contour_direction = "UP";
+    return (sum.sum + sum.compensation)/sum.count;
   }
-  else if (direction_value > -1.5)
+  else
   {
-    syll.contour_direction = "STRAIGHT";
+    return 0;
+  }
+}
+
+// Add a value to a sum and its compensation
+static void add_compensated(double &sum, double &compensation, double value)
+{
+  double result = sum + value;
+  // Whichever of the two is larger keeps its low bits, the lost ones of the other are recovered
+  if (fabs(sum) >= fabs(value))
+  {
+    compensation += (sum - result) + value;
   }
   else
   {
-    syll.contour_direction = "DOWN";
+    compensation += (value - result) + sum;
   }
-  
-  // Apply label to extreme
+  sum = result;
+}
+
+// Add a partial sum to a running total, carrying the rounding error of both
+void add_pitch_sum(pitch_sum &total, const pitch_sum &part)
+{
+  add_compensated(total.sum, total.compensation, part.sum);
+  total.compensation += part.compensation;
+  total.count += part.count;
+}
+
+// Add a single value to a running total
+void add_pitch_value(pitch_sum &total, double value)
+{
+  add_compensated(total.sum, total.compensation, value);
+  total.count += 1;
+}
+
+// Find the start, end, min, max and extreme of a contour in one pass
+contour_stats find_contour(pitch_span pitch)
+{
+  contour_stats contour;
+  contour.voiced = true;
+  contour.size = pitch.size;
+  contour.start = pitch.f0[0];
+  contour.end = pitch.f0[pitch.size - 1];
+  // The first of several equal maxima or minima is kept. The selects carry no branches
+  // so the loop can be vectorised.
   float max = -1000;
   int max_pos = -1;
   float min = 1000;
   int min_pos = -1;
-  float extreme_val = 0;
-  float extreme_pos = -1;
-  // Get max/min values and pos
-  for (int i = 0; i < syll.pitch_values.size(); i++)
-  {
-    if (syll.pitch_values.at(i)[2] > max)
-    {
-      max = syll.pitch_values.at(i)[2];
-      max_pos = i;
-    }
-    if (syll.pitch_values.at(i)[2] < min)
-    {
-      min = syll.pitch_values.at(i)[2];
-      min_pos = i;
-    }
-  }
+  for (int i = 0; i < contour.size; i++)
+  {
+    float value = pitch.f0[i];
+    bool above = value > max;
+    bool below = value < min;
+    max = above ? value : max;
+    max_pos = above ? i : max_pos;
+    min = below ? value : min;
+    min_pos = below ? i : min_pos;
+  }
+  contour.max = max;
+  contour.max_pos = max_pos;
+  contour.min = min;
+  contour.min_pos = min_pos;
   // Find largest of max/min
   if (abs(min) > max)
   {
-    extreme_val = min;
-    extreme_pos = min_pos;
+    contour.extreme = min;
+    contour.extreme_pos = min_pos;
   }
   else
   {
-    extreme_val = max;
-    extreme_pos = max_pos;
+    contour.extreme = max;
+    contour.extreme_pos = max_pos;
   }
-  
-  // Find if extreme is closer to beginning or end
-  float beg_diff = extreme_val - syll.pitch_values.front()[2];
-  float end_diff = extreme_val - syll.pitch_values.back()[2];
-  
-  // If an extreme is exactly at the end or beginning there is no extreme
-  if (extreme_pos == 0 || extreme_pos == syll.pitch_values.size() - 1)
+  return contour;
+}
+
+float f0_to_semitone(float &f0, float &mean_f0)
+{
+  float semitones = 12*log2(f0/mean_f0);
+  return semitones;
+}
+
+// Find where in the syllable the extreme is, split at the given fractions of its length
+static Extreme_Position find_extreme_position(const contour_stats &contour, double beginning_cut, double end_cut)
+{
+  float pos = (float)contour.extreme_pos / (float)contour.size;
+  if (pos >= end_cut)
   {
-    syll.contour_extreme = "NO_EXTREME";
+    return POS_END;
   }
-  else if (abs(beg_diff) < abs(end_diff)) // Else are we closer to the beginning than end?
+  else if (pos <= beginning_cut)
   {
-    // If the diff is above 1.5 a positive extreme exists
-    if (beg_diff >= 1.5)
-    {
-      syll.contour_extreme = "POSITIVE";
-    }
-    else if (beg_diff <= -1.5) // If below -1.5 a negative
-    {
-      syll.contour_extreme = "NEGATIVE";
-    }
-    else // Else none exist
-    {
-      syll.contour_extreme = "NO_EXTREME";
-    }
+    return POS_BEGINNING;
   }
-  else // We are closer to the end
+  else
   {
-    // If the diff is above 1.5 a positive extreme exists
-    if (end_diff >= 1.5)
-    {
-      syll.contour_extreme = "POSITIVE";
-    }
-    else if (end_diff <= -1.5) // If below -1.5 a negative
-    {
-      syll.contour_extreme = "NEGATIVE";
-    }
-    else // Else none exist
-    {
-      syll.contour_extreme = "NO_EXTREME";
-    }
+    return POS_MIDDLE;
   }
 }
 
-void style_jndslam(typename syllable::syllable &syll)
+// Label an extreme positive or negative if it differs by at least split from the nearer of the start and end
+static Contour_Label find_extreme_polarity(const contour_stats &contour, double split)
 {
-  // Apply label to start position
-  syll.contour_start = semitone_to_register(syll.pitch_values.front()[2], 1.5);
+  // Find if extreme is closer to beginning or end
+  float beg_diff = contour.extreme - contour.start;
+  float end_diff = contour.extreme - contour.end;
+  float diff = abs(beg_diff) < abs(end_diff) ? beg_diff : end_diff;
   
-  // Apply label to direction
-  float direction_value = syll.pitch_values.back()[2] - syll.pitch_values.front()[2];
-  if (direction_value >= 4.5)
+  // If an extreme is exactly at the end or beginning there is no extreme
+  if (contour.extreme_pos == 0 || contour.extreme_pos == contour.size - 1)
   {
-    syll.contour_direction = "VERY_UP";
+    return LABEL_NO_EXTREME;
   }
-  if (direction_value >= 1.5)
+  // If the diff is above split a positive extreme exists
+  if (diff >= split)
   {
-    syll.contour_direction = "UP";
+    return LABEL_POSITIVE;
   }
-  else if (direction_value > -1.5)
+  else if (diff <= -split) // If below -split a negative
   {
-    syll.contour_direction = "STRAIGHT";
+    return LABEL_NEGATIVE;
   }
-  else if (direction_value > -4.5)
+  else // Else none exist
   {
-    syll.contour_direction = "DOWN";
+    return LABEL_NO_EXTREME;
   }
-  else
-  {
-    syll.contour_direction = "VERY_DOWN";
-  }
-  
-  // Apply label to extreme
-  float max = -1000;
-  int max_pos = -1;
-  float min = 1000;
-  int min_pos = -1;
-  float extreme_val = 0;
-  float extreme_pos = -1;
-  // Get max/min values and pos
-  for (int i = 0; i < syll.pitch_values.size(); i++)
+}
+
+void simplified_policy::style(typename syllable::syllable &syll, const contour_stats &contour)
+{
+  // Apply label to start position
+  float start_pitch = contour.start;
+  if (start_pitch >= REGISTER_SPLIT)
   {
-    if (syll.pitch_values.at(i)[2] > max)
-    {
-      max = syll.pitch_values.at(i)[2];
-      max_pos = i;
-    }
-    if (syll.pitch_values.at(i)[2] < min)
-    {
-      min = syll.pitch_values.at(i)[2];
-      min_pos = i;
-    }
+    syll.contour_start = LABEL_HIGH;
   }
-  // Find largest of max/min
-  if (abs(min) > max)
+  else if (start_pitch > -REGISTER_SPLIT)
   {
-    extreme_val = min;
-    extreme_pos = min_pos;
+    syll.contour_start = LABEL_MEDIUM;
   }
   else
   {
-    extreme_val = max;
-    extreme_pos = max_pos;
+    syll.contour_start = LABEL_LOW;
   }
   
-  // Find if extreme is closer to beginning or end
-  float beg_diff = extreme_val - syll.pitch_values.front()[2];
-  float end_diff = extreme_val - syll.pitch_values.back()[2];
-  
-  
-  std::string extreme = "";
-  // Find position in syllable
-  float pos = (float)extreme_pos / (float)syll.pitch_values.size();
-  if (pos >= 0.7)
+  // Apply label to direction
+  float direction_value = contour.end - contour.start;
+  if (direction_value >= DIRECTION_SPLIT)
   {
-    extreme += "END_";
+    syll.contour_direction = LABEL_UP;
   }
-  else if (pos <= 0.3)
+  else if (direction_value > -DIRECTION_SPLIT)
   {
-    extreme += "BEGINNING_";
+    syll.contour_direction = LABEL_STRAIGHT;
   }
   else
   {
-    extreme += "MIDDLE_";
+    syll.contour_direction = LABEL_DOWN;
   }
   
-  // If an extreme is exactly at the end or beginning there is no extreme
-  if (extreme_pos == 0 || extreme_pos == syll.pitch_values.size() - 1)
-  {
-    extreme = "NO_EXTREME";
-  }
-  else if (abs(beg_diff) < abs(end_diff)) // Else are we closer to the beginning than end?
-  {
-    // If the diff is above 1.5 a positive extreme exists
-    if (beg_diff >= 1.5)
-    {
-      extreme += "POSITIVE";
-    }
-    else if (beg_diff <= -1.5) // If below -1.5 a negative
-    {
-      extreme += "NEGATIVE";
-    }
-    else // Else none exist
-    {
-      extreme = "NO_EXTREME";
-    }
-  }
-  else // We are closer to the end
-  {
-    // If the diff is above 1.5 a positive extreme exists
-    if (end_diff >= 1.5)
-    {
-      extreme += "POSITIVE";
-    }
-    else if (end_diff <= -1.5) // If below -1.5 a negative
-    {
-      extreme += "NEGATIVE";
-    }
-    else // Else none exist
-    {
-      extreme = "NO_EXTREME";
-    }
-  }
-  // Add the final contour
-  syll.contour_extreme = extreme;
+  // Apply label to extreme, simplified extremes have no position
+  syll.contour_extreme = find_extreme_polarity(contour, EXTREME_SPLIT);
+  syll.contour_extreme_pos = POS_NONE;
 }
 
-void style_slam(typename syllable::syllable &syll)
+void jndslam_policy::style(typename syllable::syllable &syll, const contour_stats &contour)
 {
   // Apply label to start position
-  syll.contour_start = semitone_to_register(syll.pitch_values.front()[2], 2);
+  syll.contour_start = semitone_to_register(contour.start, REGISTER_SPLIT);
   
-  
-  // Apply label to end position
-  syll.contour_direction = semitone_to_register(syll.pitch_values.back()[2], 2);
-  
-  // Apply label to extreme
-  float max = -1000;
-  int max_pos = -1;
-  float min = 1000;
-  int min_pos = -1;
-  float extreme_val = 0;
-  float extreme_pos = -1;
-  // Get max/min values and pos
-  for (int i = 0; i < syll.pitch_values.size(); i++)
-  {
-    if (syll.pitch_values.at(i)[2] > max)
-    {
-      max = syll.pitch_values.at(i)[2];
-      max_pos = i;
-    }
-    if (syll.pitch_values.at(i)[2] < min)
-    {
-      min = syll.pitch_values.at(i)[2];
-      min_pos = i;
-    }
-  }
-  // Find largest of max/min
-  if (abs(min) > max)
+  // Apply label to direction
+  float direction_value = contour.end - contour.start;
+  if (direction_value >= VERY_DIRECTION_SPLIT)
   {
-    extreme_val = min;
-    extreme_pos = min_pos;
+    syll.contour_direction = LABEL_VERY_UP;
   }
-  else
+  if (direction_value >= DIRECTION_SPLIT)
   {
-    extreme_val = max;
-    extreme_pos = max_pos;
+    syll.contour_direction = LABEL_UP;
   }
-  
-  // Find if extreme is closer to beginning or end
-  float beg_diff = extreme_val - syll.pitch_values.front()[2];
-  float end_diff = extreme_val - syll.pitch_values.back()[2];
-  
-  std::string extreme = "";
-  // Find position in syllable
-  float pos = (float)extreme_pos / (float)syll.pitch_values.size();
-  if (pos >= 0.7)
+  else if (direction_value > -DIRECTION_SPLIT)
   {
-    extreme += "END_";
+    syll.contour_direction = LABEL_STRAIGHT;
   }
-  else if (pos <= 0.3)
+  else if (direction_value > -VERY_DIRECTION_SPLIT)
   {
-    extreme += "BEGINNING_";
+    syll.contour_direction = LABEL_DOWN;
   }
   else
   {
-    extreme += "MIDDLE_";
+    syll.contour_direction = LABEL_VERY_DOWN;
   }
   
+  // Apply label to extreme. There is no position without an extreme.
+  syll.contour_extreme = find_extreme_polarity(contour, EXTREME_SPLIT);
+  syll.contour_extreme_pos = syll.contour_extreme == LABEL_NO_EXTREME ? POS_NONE : find_extreme_position(contour, BEGINNING_CUT, END_CUT);
+}
+
+void slam_policy::style(typename syllable::syllable &syll, const contour_stats &contour)
+{
+  // Apply label to start position
+  syll.contour_start = semitone_to_register(contour.start, REGISTER_SPLIT);
+  
+  // Apply label to end position
+  syll.contour_direction = semitone_to_register(contour.end, REGISTER_SPLIT);
+  
+  // Apply label to extreme
+  // Find if extreme is closer to beginning or end
+  float beg_diff = contour.extreme - contour.start;
+  float end_diff = contour.extreme - contour.end;
+  
+  Contour_Label extreme;
   // If an extreme is exactly at the end or beginning there is no extreme
-  if (extreme_pos == 0 || extreme_pos == syll.pitch_values.size() - 1)
+  if (contour.extreme_pos == 0 || contour.extreme_pos == contour.size - 1)
   {
-    extreme = "NO_EXTREME";
+    extreme = LABEL_NO_EXTREME;
   }
   else if (abs(beg_diff) < abs(end_diff)) // Else are we closer to the beginning than end?
   {
-    // If the diff is above 2 an extreme exists
-    if (abs(beg_diff) >= 2)
+    // If the diff is large enough an extreme exists
+    if (abs(beg_diff) >= BEGINNING_EXTREME_SPLIT)
     {
-      extreme += semitone_to_register(beg_diff, 2);
+      extreme = semitone_to_register(beg_diff, REGISTER_SPLIT);
     }
     else // Else none exist
     {
-      extreme = "NO_EXTREME";
+      extreme = LABEL_NO_EXTREME;
     }
   }
   else // We are closer to the end
   {
-    // If the diff is above 1.5 a positive extreme exists
-    if (abs(end_diff) >= 1.5)
+    // If the diff is large enough an extreme exists
+    if (abs(end_diff) >= END_EXTREME_SPLIT)
     {
-      extreme += semitone_to_register(end_diff, 2);
+      extreme = semitone_to_register(end_diff, REGISTER_SPLIT);
     }
     else // Else none exist
     {
-      extreme = "NO_EXTREME";
+      extreme = LABEL_NO_EXTREME;
     }
   }
-  // Add the final contour
+  // Add the final contour. There is no position without an extreme.
   syll.contour_extreme = extreme;
+  syll.contour_extreme_pos = extreme == LABEL_NO_EXTREME ? POS_NONE : find_extreme_position(contour, BEGINNING_CUT, END_CUT);
 }
 
-
 // Style a segment outputting the raw values
-void style_raw(typename syllable::syllable &syll)
+void raw_policy::style(typename syllable::syllable &syll, const contour_stats &contour)
 {
   // Apply label to start position
-  syll.contour_start = std::to_string(syll.pitch_values.front()[2]);
-  
+  syll.contour_start = LABEL_RAW;
+  syll.raw_start = contour.start;
   
   // Apply label to end position
-  syll.contour_direction = std::to_string(syll.pitch_values.back()[2]);
+  syll.contour_direction = LABEL_RAW;
+  syll.raw_direction = contour.end;
   
   // Apply label to extreme
-  float max = -1000;
-  int max_pos = -1;
-  float min = 1000;
-  int min_pos = -1;
-  float extreme_val = 0;
-  float extreme_pos = -1;
-  // Get max/min values and pos
-  for (int i = 0; i < syll.pitch_values.size(); i++)
-  {
-    if (syll.pitch_values.at(i)[2] > max)
-    {
-      max = syll.pitch_values.at(i)[2];
-      max_pos = i;
-    }
-    if (syll.pitch_values.at(i)[2] < min)
-    {
-      min = syll.pitch_values.at(i)[2];
-      min_pos = i;
-    }
-  }
-  // Find largest of max/min
-  if (abs(min) > max)
-  {
-    extreme_val = min;
-    extreme_pos = min_pos;
-  }
-  else
-  {
-    extreme_val = max;
-    extreme_pos = max_pos;
-  }
-  
   // Find position in syllable
-  syll.contour_extreme_pos = std::to_string((float)extreme_pos / (float)syll.pitch_values.size());
+  syll.raw_extreme_pos = (float)contour.extreme_pos / (float)contour.size;
   
-  // Add raw value
-  syll.contour_extreme = std::to_string(extreme_val);
+  // Add raw value, the position is a value of its own rather than a label prefix
+  syll.contour_extreme = LABEL_RAW;
+  syll.contour_extreme_pos = POS_NONE;
+  syll.raw_extreme = contour.extreme;
+}
+
+void style_simplified(typename syllable::syllable &syll, const contour_stats &contour)
+{
+  simplified_policy::style(syll, contour);
+}
+
+void style_jndslam(typename syllable::syllable &syll, const contour_stats &contour)
+{
+  jndslam_policy::style(syll, contour);
+}
+
+void style_slam(typename syllable::syllable &syll, const contour_stats &contour)
+{
+  slam_policy::style(syll, contour);
+}
+
+void style_raw(typename syllable::syllable &syll, const contour_stats &contour)
+{
+  raw_policy::style(syll, contour);
 }
 
 // Converts a semitone value into a 5 level register based on the split value
-std::string semitone_to_register(float semitone, float split)
+Contour_Label semitone_to_register(float semitone, float split)
 {
   if (semitone >= split*3)
   {
-    return "VERY_HIGH";
+    return LABEL_VERY_HIGH;
   }
   else if (semitone >= split)
   {
-    return "HIGH";
+    return LABEL_HIGH;
   }
   else if (semitone > -split)
   {
-    return "MEDIUM";
+    return LABEL_MEDIUM;
   }
   else if (semitone > -split*3)
   {
-    return "LOW";
+    return LABEL_LOW;
   }
   else
   {
-    return "VERY_LOW";
+    return LABEL_VERY_LOW;
   }
 }
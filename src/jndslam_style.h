@@ -16,6 +16,7 @@
 #define JNDSLAM_STYLE_H
 
 #include <vector>
+#include <string>
 #include <iostream>
 #include <stdexcept>
 
@@ -23,35 +24,198 @@
 
 #include "utterance.h"
 #include "syllable.h"
+#include "pitch_track.h"
 
 // The possible algorithms
 enum Style_Alg {SIMPLIFIED, JNDSLAM, SLAM, RAW};
 
+// Running sum of voiced pitch values used for finding the mean pitch of a speaker.
+// The rounding error of the sum is carried in compensation (Neumaier summation) so
+// the mean stays exact over any number of frames.
+struct pitch_sum
+{
+  double sum;
+  unsigned long count;
+  double compensation;
+};
+
+// What the stylisation algorithms need to know about the semitone contour of a syllable
+struct contour_stats
+{
+  // False if the syllable has too few voiced frames to stylise, nothing else is set then
+  bool voiced;
+  // Number of values in the contour
+  int size;
+  // First and last value
+  float start;
+  float end;
+  // Smallest and largest value and where they first occur
+  float min;
+  float max;
+  int min_pos;
+  int max_pos;
+  // The min if it is further from 0 than the max, otherwise the max
+  float extreme;
+  int extreme_pos;
+};
+
+// Stylisation policies. Each algorithm is a type holding its thresholds as compile time
+// constants and a style() that labels a syllable from its semitone contour.
+// stylise_utt<Policy> is instantiated once per algorithm so nothing is decided per syllable.
+// A new algorithm or JND variant is a new policy type.
+
+// Simplified JNDSLAM
+struct simplified_policy
+{
+  static constexpr Style_Alg algorithm = SIMPLIFIED;
+  // Semitones from the mean for a HIGH or LOW start
+  static constexpr double REGISTER_SPLIT = 1.5;
+  // Semitones of movement for an UP or DOWN direction
+  static constexpr double DIRECTION_SPLIT = 1.5;
+  // Semitones an extreme must differ from the nearer of start and end
+  static constexpr double EXTREME_SPLIT = 1.5;
+  static void style(typename syllable::syllable &syll, const contour_stats &contour);
+};
+
+// JNDSLAM
+struct jndslam_policy
+{
+  static constexpr Style_Alg algorithm = JNDSLAM;
+  // Semitones from the mean between start registers
+  static constexpr double REGISTER_SPLIT = 1.5;
+  // Semitones of movement for UP/DOWN and for VERY_UP/VERY_DOWN
+  static constexpr double DIRECTION_SPLIT = 1.5;
+  static constexpr double VERY_DIRECTION_SPLIT = 4.5;
+  // Semitones an extreme must differ from the nearer of start and end
+  static constexpr double EXTREME_SPLIT = 1.5;
+  // Fractions of the syllable up to which an extreme is at the BEGINNING and from which it is at the END
+  static constexpr double BEGINNING_CUT = 0.3;
+  static constexpr double END_CUT = 0.7;
+  static void style(typename syllable::syllable &syll, const contour_stats &contour);
+};
+
+// The original SLAM
+struct slam_policy
+{
+  static constexpr Style_Alg algorithm = SLAM;
+  // Semitones from the mean between registers
+  static constexpr double REGISTER_SPLIT = 2;
+  // Semitones an extreme must differ from the start when nearer the start, and from the end when nearer the end
+  static constexpr double BEGINNING_EXTREME_SPLIT = 2;
+  static constexpr double END_EXTREME_SPLIT = 1.5;
+  // Fractions of the syllable up to which an extreme is at the BEGINNING and from which it is at the END
+  static constexpr double BEGINNING_CUT = 0.3;
+  static constexpr double END_CUT = 0.7;
+  static void style(typename syllable::syllable &syll, const contour_stats &contour);
+};
+
+// Raw semitone values
+struct raw_policy
+{
+  static constexpr Style_Alg algorithm = RAW;
+  static void style(typename syllable::syllable &syll, const contour_stats &contour);
+};
+
+// Convert the pitch of each syllable of an utterance to semitones around mean_pitch and find its contour.
+// This is only done once however many algorithms are then applied with style_contours.
+void find_contours(typename utterance::utterance &utt, float mean_pitch, std::vector<contour_stats> &contours);
+
+// Label a syllable unvoiced
+void style_unvoiced(typename syllable::syllable &syll);
+
+// Label every syllable of an utterance from its contour with the algorithm of a policy
+template <typename Policy>
+void style_contours(typename utterance::utterance &utt, const std::vector<contour_stats> &contours)
+{
+  for (size_t j = 0; j < utt.sylls.size(); j++)
+  {
+    if (contours[j].voiced)
+    {
+      Policy::style(utt.sylls[j], contours[j]);
+    }
+    else
+    {
+      style_unvoiced(utt.sylls[j]);
+    }
+  }
+}
+
+// Label every syllable of an utterance from its contour with an algorithm
+void style_contours(typename utterance::utterance &utt, const std::vector<contour_stats> &contours, Style_Alg algorithm);
+
+// Stylise all syllables in an utterance with the algorithm of a policy
+template <typename Policy>
+void stylise_utt(typename utterance::utterance &utt, float mean_pitch)
+{
+  std::vector<contour_stats> contours;
+  find_contours(utt, mean_pitch, contours);
+  style_contours<Policy>(utt, contours);
+}
+
+// Stylise all syllables in a list of utterances with the algorithm of a policy
+template <typename Policy>
+void stylise_utts(std::vector<typename utterance::utterance> &utts, float mean_pitch)
+{
+  for (size_t i = 0; i < utts.size(); i++)
+  {
+    stylise_utt<Policy>(utts[i], mean_pitch);
+  }
+}
+
 // Stylise all syllables in a list of utterances
 void stylise(std::vector<typename utterance::utterance> &utts, Style_Alg algorithm=SIMPLIFIED);
 
+// Stylise all syllables in an utterance relative to the mean pitch of the speaker.
+// The algorithm is chosen once for the utterance.
+void stylise_utt(typename utterance::utterance &utt, Style_Alg algorithm, float mean_pitch);
+
 // Calculate the mean pitch of the speaker
 float calc_mean_pitch(std::vector<typename utterance::utterance> &utts);
 
+// Sum the voiced pitch values of an utterance.
+// The sums of several utterances can be found independently and then combined with calc_mean_pitch.
+pitch_sum calc_pitch_sum(typename utterance::utterance &utt);
+
+// Calculate the mean pitch from a list of partial sums. The sums are combined in order so the
+// result is the same no matter how the partial sums were obtained.
+float calc_mean_pitch(std::vector<pitch_sum> &sums);
+
+// Calculate the mean pitch from a sum
+float calc_mean_pitch(pitch_sum &sum);
+
+// Add a partial sum to a running total, carrying the rounding error of both
+void add_pitch_sum(pitch_sum &total, const pitch_sum &part);
+
+// Add a single value to a running total
+void add_pitch_value(pitch_sum &total, double value);
+
+// Find the start, end, min, max and extreme of a contour in a single pass over its values.
+// All algorithms work from this so the contour is only scanned once.
+contour_stats find_contour(pitch_span pitch);
+
 // Convert a pitch values to its semitone difference from a reference
 float f0_to_semitone(float &f0, float &mean_f0);
 
 // Style a syllable using Simplified JNDSLAM
-void style_simplified(typename syllable::syllable &syll);
+void style_simplified(typename syllable::syllable &syll, const contour_stats &contour);
 
 // Style a syllable using JNDSLAM
-void style_jndslam(typename syllable::syllable &syll);
+void style_jndslam(typename syllable::syllable &syll, const contour_stats &contour);
 
 // Style a syllable using the original SLAM algorithm from
 // Obin, N., Beliao, J., Veaux, C., & Lacheret, A. (2014). SLAM: Automatic Stylization and Labelling of Speech Melody. Speech Prosody 7, 246-250.
-void style_slam(typename syllable::syllable &syll);
+void style_slam(typename syllable::syllable &syll, const contour_stats &contour);
 
 
 // Style a segment outputting the raw values (start value, end value, extreme value). This also outputs position of the extreme in the segment as the fourth value.
 // The movement value can be obtained by subtracting the start value from the end value.
-void style_raw(typename syllable::syllable &syll);
+void style_raw(typename syllable::syllable &syll, const contour_stats &contour);
+
+// Convert between algorithm names as given to -a and the enum. Throws on an unknown name.
+Style_Alg style_alg_from_string(const std::string &name);
+std::string style_alg_to_string(Style_Alg algorithm);
 
 // Convert a semitone to its register value in 5 levels based on split.
-std::string semitone_to_register(float semitone, float split);
+Contour_Label semitone_to_register(float semitone, float split);
 
 #endif
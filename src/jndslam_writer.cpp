@@ -0,0 +1,221 @@
+/* Copyright 2015 Rasmus Dall - rasmus@dall.dk
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+#include "jndslam_writer.h"
+
+file_writer::file_writer(size_t max_pending)
+{
+  this->max_pending = max_pending > 0 ? max_pending : 1;
+  this->failures = 0;
+  this->done = false;
+  this->thread = std::thread(&file_writer::run, this);
+}
+
+file_writer::~file_writer()
+{
+  finish();
+}
+
+// An empty buffer to format a file into
+std::string file_writer::take_buffer()
+{
+  std::lock_guard<std::mutex> guard(lock);
+  std::string buffer;
+  if (!spare.empty())
+  {
+    buffer.swap(spare.back());
+    spare.pop_back();
+  }
+  buffer.clear();
+  return buffer;
+}
+
+// Queue contents to be written to path
+void file_writer::submit(const std::string &path, std::string &contents)
+{
+  std::unique_lock<std::mutex> guard(lock);
+  if (done)
+  {
+    throw std::invalid_argument("Can not write "+path+" after the writer has finished");
+  }
+  // Wait for room so a slow disk can not make the queue grow without bound
+  while (queue.size() >= max_pending)
+  {
+    changed.wait(guard);
+  }
+  queue.push_back(std::make_pair(path, std::string()));
+  queue.back().second.swap(contents);
+  changed.notify_all();
+}
+
+// Wait for every queued file to be written and stop the background thread
+size_t file_writer::finish()
+{
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    done = true;
+    changed.notify_all();
+  }
+  if (thread.joinable())
+  {
+    thread.join();
+  }
+  return failures;
+}
+
+// Write out queued files until finished and the queue is empty
+void file_writer::run()
+{
+  std::unique_lock<std::mutex> guard(lock);
+  while (true)
+  {
+    while (queue.empty() && !done)
+    {
+      changed.wait(guard);
+    }
+    if (queue.empty())
+    {
+      return void();
+    }
+    std::pair<std::string, std::string> file;
+    file.first.swap(queue.front().first);
+    file.second.swap(queue.front().second);
+    queue.pop_front();
+    changed.notify_all();
+    
+    // The disk is written without holding the lock
+    guard.unlock();
+    bool failed = false;
+    try
+    {
+      write_file(file.first, file.second);
+    }
+    catch (const std::exception &e)
+    {
+      std::cerr << "ERROR! " << e.what() << std::endl;
+      failed = true;
+    }
+    guard.lock();
+    
+    if (failed)
+    {
+      failures++;
+    }
+    spare.push_back(std::string());
+    spare.back().swap(file.second);
+  }
+}
+
+// Records are written once this much is gathered
+static const size_t RECORD_FLUSH_SIZE = 1 << 20;
+
+record_writer::record_writer(const std::string &path)
+{
+  this->path = path == "-" ? "stdout" : path;
+  this->next = 0;
+  this->offset = 0;
+  if (path == "-")
+  {
+    this->fd = STDOUT_FILENO;
+  }
+  else
+  {
+    this->fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (this->fd < 0)
+    {
+      throw std::runtime_error("Could not open "+path+" for writing: "+strerror(errno));
+    }
+  }
+}
+
+record_writer::~record_writer()
+{
+  if (fd > STDERR_FILENO)
+  {
+    close(fd);
+  }
+}
+
+// Add record number i
+void record_writer::add(size_t i, const std::string &name, std::string &record)
+{
+  std::lock_guard<std::mutex> guard(lock);
+  if (fd < 0)
+  {
+    throw std::invalid_argument("Can not write to "+path+" after the writer has finished");
+  }
+  pending[i].first = name;
+  pending[i].second.swap(record);
+  // Move every record that is now in order to the buffer
+  std::map<size_t, std::pair<std::string, std::string> >::iterator it = pending.begin();
+  while (it != pending.end() && it->first == next)
+  {
+    record_span span = {offset, it->second.second.size()};
+    spans.push_back(std::make_pair(it->second.first, span));
+    buffer += it->second.second;
+    offset += span.length;
+    next++;
+    pending.erase(it);
+    it = pending.begin();
+  }
+  if (buffer.size() >= RECORD_FLUSH_SIZE)
+  {
+    flush();
+  }
+}
+
+// Write out the gathered records
+void record_writer::flush()
+{
+  write_all(fd, buffer.data(), buffer.size(), path);
+  buffer.clear();
+}
+
+// Write everything out and close the file
+void record_writer::finish()
+{
+  std::lock_guard<std::mutex> guard(lock);
+  if (fd < 0)
+  {
+    return void();
+  }
+  if (!pending.empty())
+  {
+    throw std::invalid_argument("Record "+std::to_string(next)+" was never added to "+path);
+  }
+  flush();
+  if (fd > STDERR_FILENO && close(fd) != 0)
+  {
+    fd = -1;
+    throw std::runtime_error("Could not write "+path+": "+strerror(errno));
+  }
+  fd = -1;
+}
+
+// Write the index of the records
+void record_writer::write_index(const std::string &path)
+{
+  std::lock_guard<std::mutex> guard(lock);
+  std::string index;
+  for (size_t i = 0; i < spans.size(); i++)
+  {
+    index += spans[i].first;
+    index += ' ';
+    index += std::to_string(spans[i].second.offset);
+    index += ' ';
+    index += std::to_string(spans[i].second.length);
+    index += '\n';
+  }
+  write_file(path, index);
+}
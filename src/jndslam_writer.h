@@ -0,0 +1,103 @@
+/* Copyright 2015 Rasmus Dall - rasmus@dall.dk
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+#ifndef JNDSLAM_WRITER_H
+#define JNDSLAM_WRITER_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <utility>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "jndslam_io.h"
+
+// Writes whole files on a background thread so the threads formatting them never wait on the disk.
+// Files are formatted into buffers taken from the writer and handed back with submit(). Once written
+// a buffer is kept for reuse so formatting does not allocate once the buffers have grown.
+// A file that can not be written is reported on stderr and counted, it is never silently dropped.
+class file_writer
+{
+public:
+  // At most max_pending files wait to be written before submit() blocks
+  explicit file_writer(size_t max_pending=64);
+  // Waits for every queued file to be written
+  ~file_writer();
+  // An empty buffer to format a file into
+  std::string take_buffer();
+  // Queue contents to be written to path. The writer takes over the buffer and contents is left empty.
+  void submit(const std::string &path, std::string &contents);
+  // Wait for every queued file to be written and stop the background thread.
+  // Returns the number of files that could not be written.
+  size_t finish();
+private:
+  // A writer owns its thread so it can not be copied
+  file_writer(const file_writer &other);
+  file_writer &operator=(const file_writer &other);
+  // Body of the background thread
+  void run();
+  std::mutex lock;
+  std::condition_variable changed;
+  // Files waiting to be written as path and contents
+  std::deque<std::pair<std::string, std::string> > queue;
+  // Written buffers ready for reuse
+  std::vector<std::string> spare;
+  size_t max_pending;
+  size_t failures;
+  bool done;
+  std::thread thread;
+};
+
+// Writes records to a single file, or stdout, in the order of their index whatever order they are
+// added in. A record waits in memory until every record before it has been added, so with records
+// added roughly in order only a few are held at a time. Records are gathered into large writes and
+// the span of each is kept so an index from name to byte offset can be written at the end.
+class record_writer
+{
+public:
+  // Write to path, or to stdout if path is "-". Throws if the file can not be opened.
+  explicit record_writer(const std::string &path);
+  // Closes the file without writing anything still waiting
+  ~record_writer();
+  // Add record number i. The writer takes over the buffer and record is left empty.
+  // Every index from 0 up must be added exactly once. Throws if the file can not be written.
+  void add(size_t i, const std::string &name, std::string &record);
+  // Write everything out and close the file. Throws if a record is missing or it can not be written.
+  void finish();
+  // Write the index of the records as lines of "name offset length". Only valid after finish().
+  void write_index(const std::string &path);
+private:
+  // A writer owns its file so it can not be copied
+  record_writer(const record_writer &other);
+  record_writer &operator=(const record_writer &other);
+  // Write out the gathered records
+  void flush();
+  std::mutex lock;
+  std::string path;
+  int fd;
+  // Records waiting for the ones before them as name and contents
+  std::map<size_t, std::pair<std::string, std::string> > pending;
+  // Records ready to be written
+  std::string buffer;
+  size_t next;
+  uint64_t offset;
+  std::vector<std::pair<std::string, record_span> > spans;
+};
+
+#endif
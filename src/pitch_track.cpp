@@ -0,0 +1,71 @@
+/* Copyright 2015 Rasmus Dall - rasmus@dall.dk
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+#include "pitch_track.h"
+
+size_t pitch_track::size() const
+{
+  return this->f0.size();
+}
+
+void pitch_track::push_back(float time, float voiced, float value)
+{
+  this->times.push_back(time);
+  this->voicing.push_back(voiced);
+  this->f0.push_back(value);
+}
+
+void pitch_track::reserve(size_t size)
+{
+  this->times.reserve(size);
+  this->voicing.reserve(size);
+  this->f0.reserve(size);
+}
+
+void pitch_track::clear()
+{
+  this->times.clear();
+  this->voicing.clear();
+  this->f0.clear();
+}
+
+// Remove the first count frames
+void pitch_track::drop_front(size_t count)
+{
+  this->times.erase(this->times.begin(), this->times.begin() + count);
+  this->voicing.erase(this->voicing.begin(), this->voicing.begin() + count);
+  this->f0.erase(this->f0.begin(), this->f0.begin() + count);
+}
+
+pitch_span::pitch_span(pitch_track &track, size_t begin, size_t end)
+{
+  this->times = track.times.data() + begin;
+  this->voicing = track.voicing.data() + begin;
+  this->f0 = track.f0.data() + begin;
+  this->size = end - begin;
+}
+
+pitch_span::pitch_span(float *times, float *voicing, float *f0, size_t size)
+{
+  this->times = times;
+  this->voicing = voicing;
+  this->f0 = f0;
+  this->size = size;
+}
+
+// The frames [begin, end) of this span
+pitch_span pitch_span::slice(size_t begin, size_t end) const
+{
+  return pitch_span(this->times + begin, this->voicing + begin, this->f0 + begin, end - begin);
+}
@@ -0,0 +1,52 @@
+/* Copyright 2015 Rasmus Dall - rasmus@dall.dk
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+#ifndef PITCH_TRACK_H
+#define PITCH_TRACK_H
+
+#include <vector>
+#include <cstddef>
+
+// A track of pitch frames. Time, voicing and f0 are kept in three contiguous arrays
+// so a range of frames can be worked on without touching anything else.
+struct pitch_track
+{
+public:
+  std::vector<float> times;
+  std::vector<float> voicing;
+  std::vector<float> f0;
+  size_t size() const;
+  void push_back(float time, float voiced, float value);
+  void reserve(size_t size);
+  void clear();
+  // Remove the first count frames
+  void drop_front(size_t count);
+};
+
+// A range of frames in a pitch track. It points straight into the track so it is only valid
+// until the track next changes size.
+struct pitch_span
+{
+public:
+  pitch_span(pitch_track &track, size_t begin, size_t end);
+  pitch_span(float *times, float *voicing, float *f0, size_t size);
+  // The frames [begin, end) of this span
+  pitch_span slice(size_t begin, size_t end) const;
+  float *times;
+  float *voicing;
+  float *f0;
+  size_t size;
+};
+
+#endif
@@ -20,5 +20,50 @@ syllable::syllable(float start, float end, std::string identity)
 {
 	this->start = start;
 	this->end = end;
-	this->identity = identity;
+	this->identity = std::move(identity);
+	this->frames_begin = 0;
+	this->frames_end = 0;
+	this->pitch_begin = 0;
+	this->pitch_end = 0;
+	this->contour_start = LABEL_NONE;
+	this->contour_direction = LABEL_NONE;
+	this->contour_extreme = LABEL_NONE;
+	this->contour_extreme_pos = POS_NONE;
+	this->raw_start = 0;
+	this->raw_direction = 0;
+	this->raw_extreme = 0;
+	this->raw_extreme_pos = 0;
+}
+
+// The text of a label
+const char *contour_label_text(Contour_Label label)
+{
+	static const char *const text[] = {
+		"",
+		"",
+		"UNVOICED_START",
+		"UNVOICED_DIRECTION",
+		"UNVOICED_EXTREME",
+		"NO_EXTREME",
+		"VERY_HIGH",
+		"HIGH",
+		"MEDIUM",
+		"LOW",
+		"VERY_LOW",
+		"VERY_UP",
+		"UP",
+		"STRAIGHT",
+		"DOWN",
+		"VERY_DOWN",
+		"POSITIVE",
+		"NEGATIVE"
+	};
+	return text[label];
+}
+
+// The text of an extreme position prefix
+const char *extreme_position_text(Extreme_Position pos)
+{
+	static const char *const text[] = {"", "BEGINNING_", "MIDDLE_", "END_"};
+	return text[pos];
 }
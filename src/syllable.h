@@ -17,6 +17,41 @@
 
 #include <string>
 #include <vector>
+#include <cstddef>
+#include <utility>
+
+// The words of a contour label. LABEL_NONE is written as nothing and LABEL_RAW
+// means the syllable's raw value is written instead.
+enum Contour_Label : unsigned char
+{
+	LABEL_NONE,
+	LABEL_RAW,
+	LABEL_UNVOICED_START,
+	LABEL_UNVOICED_DIRECTION,
+	LABEL_UNVOICED_EXTREME,
+	LABEL_NO_EXTREME,
+	LABEL_VERY_HIGH,
+	LABEL_HIGH,
+	LABEL_MEDIUM,
+	LABEL_LOW,
+	LABEL_VERY_LOW,
+	LABEL_VERY_UP,
+	LABEL_UP,
+	LABEL_STRAIGHT,
+	LABEL_DOWN,
+	LABEL_VERY_DOWN,
+	LABEL_POSITIVE,
+	LABEL_NEGATIVE
+};
+
+// Where in a syllable an extreme is. It is written as a prefix of the extreme label.
+enum Extreme_Position : unsigned char {POS_NONE, POS_BEGINNING, POS_MIDDLE, POS_END};
+
+// The text of a label
+const char *contour_label_text(Contour_Label label);
+
+// The text of an extreme position prefix, e.g. "BEGINNING_"
+const char *extreme_position_text(Extreme_Position pos);
 
 struct syllable
 {
@@ -25,11 +60,22 @@ public:
 	float start;
 	float end;
 	std::string identity;
-	std::vector<std::vector<float> > pitch_values;
-	std::string contour_start;
-	std::string contour_direction;
-	std::string contour_extreme;
-	std::string contour_extreme_pos;
+	// The frames of the syllable in the utterance's frames track
+	size_t frames_begin;
+	size_t frames_end;
+	// The voiced pitch values of the syllable in the utterance's pitch track
+	size_t pitch_begin;
+	size_t pitch_end;
+	// The stylised contour as label codes. They only become text when written out.
+	Contour_Label contour_start;
+	Contour_Label contour_direction;
+	Contour_Label contour_extreme;
+	Extreme_Position contour_extreme_pos;
+	// The values written for LABEL_RAW. The extreme position is relative to the syllable's voiced frames.
+	float raw_start;
+	float raw_direction;
+	float raw_extreme;
+	float raw_extreme_pos;
 };
 
 #endif
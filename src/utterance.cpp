@@ -19,3 +19,13 @@ utterance::utterance(std::string name)
 {
   this->name = name;
 }
+
+pitch_span utterance::syll_frames(size_t i)
+{
+  return pitch_span(this->frames, this->sylls[i].frames_begin, this->sylls[i].frames_end);
+}
+
+pitch_span utterance::syll_pitch(size_t i)
+{
+  return pitch_span(this->pitch, this->sylls[i].pitch_begin, this->sylls[i].pitch_end);
+}
@@ -19,6 +19,19 @@
 #include <vector>
 
 #include "syllable.h"
+#include "pitch_track.h"
+
+// The syllable of a phone that is in none
+const size_t NO_SYLL = (size_t)-1;
+
+// A phone of an HTS label file as found when it was parsed
+struct lab_phone
+{
+  // Byte offset in the file just past the context of the phone
+  size_t context_end;
+  // The index of the syllable of the phone or NO_SYLL
+  size_t syll;
+};
 
 struct utterance
 {
@@ -26,6 +39,16 @@ public:
   explicit utterance(std::string name);
   std::vector<typename syllable::syllable> sylls;
   std::string name;
+  // The pitch frames as read from the EST file
+  pitch_track frames;
+  // The voiced, and possibly smoothed, pitch values the syllables are stylised from
+  pitch_track pitch;
+  // The phones of the HTS label file the syllables were parsed from. Empty for other labels.
+  std::vector<lab_phone> phones;
+  // The frames of syllable i
+  pitch_span syll_frames(size_t i);
+  // The pitch values of syllable i
+  pitch_span syll_pitch(size_t i);
 };
 
 #endif